@@ -0,0 +1,216 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief Contiguous storage for a set of batches.
+ *
+ * All batches live in a single slab aligned to the padding, and each batch starts on an aligned address.
+ * The memory is not initialized, and it is reused when the arena is reset with a size that fits in it.
+ * Slots can be used by index, or handed out and given back with acquire() and release().
+ *
+ * @tparam T Data type of the batches.
+ */
+template <typename T>
+class BatchArena
+{
+    static_assert(std::is_trivial<T>::value, "BatchArena only stores trivial types.");
+
+  public:
+    BatchArena();
+    /**
+     * @brief Allocate the arena.
+     *
+     * @param nrSlots Number of batches.
+     * @param slotSize Number of elements of each batch.
+     * @param padding Padding, in bytes, used for cache aligning.
+     */
+    BatchArena(const std::size_t nrSlots, const std::size_t slotSize, const unsigned int padding);
+    BatchArena(const BatchArena &) = delete;
+    BatchArena &operator=(const BatchArena &) = delete;
+    BatchArena(BatchArena &&) = default;
+    BatchArena &operator=(BatchArena &&) = default;
+
+    /**
+     * @brief Change the number and size of the batches, allocating memory only if the current slab is too small.
+     * The content of the arena is not preserved, and all slots become free.
+     *
+     * @param nrSlots Number of batches.
+     * @param slotSize Number of elements of each batch.
+     * @param padding Padding, in bytes, used for cache aligning.
+     */
+    void reset(const std::size_t nrSlots, const std::size_t slotSize, const unsigned int padding);
+    /**
+     * @brief Number of batches in the arena.
+     */
+    std::size_t getNrSlots() const;
+    /**
+     * @brief Number of elements of each batch.
+     */
+    std::size_t getSlotSize() const;
+    /**
+     * @brief Pointer to the first element of a batch.
+     *
+     * @param slot The index of the batch.
+     */
+    T *getSlot(const std::size_t slot);
+    const T *getSlot(const std::size_t slot) const;
+    /**
+     * @brief Pointers to the first element of all batches, in order.
+     */
+    std::vector<T *> getSlots();
+    /**
+     * @brief Take a free batch.
+     *
+     * @return The batch, or a null pointer if all batches are in use.
+     */
+    T *acquire();
+    /**
+     * @brief Give back a batch taken with acquire().
+     *
+     * @param slot The batch.
+     */
+    void release(T *slot);
+
+  private:
+    struct Deleter
+    {
+        void operator()(T *memory) const
+        {
+            std::free(memory);
+        }
+    };
+
+    std::unique_ptr<T[], Deleter> slab;
+    std::size_t capacity;
+    std::size_t alignment;
+    std::size_t nrSlots;
+    std::size_t slotSize;
+    std::size_t slotStride;
+    std::vector<std::size_t> freeSlots;
+};
+
+// Implementations
+
+template <typename T>
+BatchArena<T>::BatchArena() : capacity(0), alignment(0), nrSlots(0), slotSize(0), slotStride(0) {}
+
+template <typename T>
+BatchArena<T>::BatchArena(const std::size_t nrSlots, const std::size_t slotSize, const unsigned int padding) : BatchArena()
+{
+    reset(nrSlots, slotSize, padding);
+}
+
+template <typename T>
+void BatchArena<T>::reset(const std::size_t nrSlots, const std::size_t slotSize, const unsigned int padding)
+{
+    // The alignment must be a power of two multiple of the type alignment
+    std::size_t newAlignment = alignof(T) < sizeof(void *) ? sizeof(void *) : alignof(T);
+
+    while (newAlignment < padding)
+    {
+        newAlignment *= 2;
+    }
+    this->nrSlots = nrSlots;
+    this->slotSize = slotSize;
+    slotStride = ((((slotSize * sizeof(T)) + newAlignment - 1) / newAlignment) * newAlignment) / sizeof(T);
+    if ((nrSlots * slotStride > capacity) || (newAlignment > alignment))
+    {
+        void *memory = nullptr;
+
+        slab.reset();
+        capacity = 0;
+        if (posix_memalign(&memory, newAlignment, std::max(nrSlots * slotStride * sizeof(T), newAlignment)) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        slab.reset(reinterpret_cast<T *>(memory));
+        capacity = nrSlots * slotStride;
+        alignment = newAlignment;
+    }
+    freeSlots.resize(nrSlots);
+    for (std::size_t slot = 0; slot < nrSlots; slot++)
+    {
+        freeSlots.at(slot) = nrSlots - 1 - slot;
+    }
+}
+
+template <typename T>
+inline std::size_t BatchArena<T>::getNrSlots() const
+{
+    return nrSlots;
+}
+
+template <typename T>
+inline std::size_t BatchArena<T>::getSlotSize() const
+{
+    return slotSize;
+}
+
+template <typename T>
+inline T *BatchArena<T>::getSlot(const std::size_t slot)
+{
+    return slab.get() + (slot * slotStride);
+}
+
+template <typename T>
+inline const T *BatchArena<T>::getSlot(const std::size_t slot) const
+{
+    return slab.get() + (slot * slotStride);
+}
+
+template <typename T>
+std::vector<T *> BatchArena<T>::getSlots()
+{
+    std::vector<T *> slots(nrSlots);
+
+    for (std::size_t slot = 0; slot < nrSlots; slot++)
+    {
+        slots.at(slot) = getSlot(slot);
+    }
+    return slots;
+}
+
+template <typename T>
+T *BatchArena<T>::acquire()
+{
+    std::size_t slot = 0;
+
+    if (freeSlots.empty())
+    {
+        return nullptr;
+    }
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+    return getSlot(slot);
+}
+
+template <typename T>
+void BatchArena<T>::release(T *slot)
+{
+    freeSlots.push_back((slot - slab.get()) / slotStride);
+}
+
+} // namespace AstroData
@@ -0,0 +1,394 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "WriteData.hpp"
+
+#pragma once
+
+namespace AstroData
+{
+
+// Size, in bytes, of the header page and alignment of the batches in a batch file
+const std::uint64_t batchFileAlignment = 4096;
+
+/**
+ * @brief How a batch is stored in a batch file.
+ */
+enum class BatchEncoding : std::uint32_t
+{
+    // The padded channel-major batch, as it is in memory
+    Raw = 0,
+    // Bit planes of the batch, run-length encoded
+    BitshuffleRLE = 1
+};
+
+/**
+ * @brief Entry of the index of a batch file.
+ */
+struct BatchFileEntry
+{
+    // Offset, in bytes, of the batch in the file
+    std::uint64_t offset;
+    // Size, in bytes, of the stored batch
+    std::uint64_t size;
+    BatchEncoding encoding;
+    std::uint32_t reserved;
+};
+
+/**
+ * @brief Writer of AstroData batch files.
+ *
+ * A batch file stores padded channel-major batches, exactly as they are in memory, so that they can be
+ * used again without transposing them. The file starts with a header page containing the observation
+ * parameters, followed by the batches, each starting on a page boundary, and ends with an index
+ * containing the offset, size and encoding of every batch.
+ * Batches can be compressed by splitting them in bit planes, i.e. bitshuffle, and run-length encoding
+ * the planes; a batch is stored raw when compression does not reduce its size.
+ *
+ * @tparam T Data type of the batches.
+ */
+template <typename T>
+class BatchFileWriter
+{
+  public:
+    /**
+     * @brief Create a batch file.
+     *
+     * @param observation Object containing the observation parameters.
+     * @param padding Padding used for cache aligning.
+     * @param inputBits Number of bits each sample is represented with.
+     * @param outputFilename Name of the batch file.
+     * @param encoding How the batches are stored.
+     */
+    BatchFileWriter(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::string &outputFilename, const BatchEncoding encoding = BatchEncoding::Raw);
+    BatchFileWriter(const BatchFileWriter &) = delete;
+    BatchFileWriter &operator=(const BatchFileWriter &) = delete;
+    ~BatchFileWriter();
+
+    /**
+     * @brief Append a batch to the file.
+     *
+     * @param data The batch, in padded channel-major layout.
+     */
+    void write(const T *data);
+    void write(const std::vector<T> &data);
+    /**
+     * @brief Write the index and close the file; the file is not readable before it is closed.
+     */
+    void close();
+    /**
+     * @brief Number of batches written so far.
+     */
+    unsigned int getNrBatches() const;
+
+  private:
+    Observation observation;
+    unsigned int padding;
+    uint8_t inputBits;
+    BatchEncoding encoding;
+    int outputFile;
+    std::uint64_t batchSize;
+    std::uint64_t offset;
+    std::vector<BatchFileEntry> index;
+    BatchArena<uint8_t> buffers;
+};
+
+/**
+ * @brief Read-only memory mapping of an AstroData batch file.
+ *
+ * The index is read when the file is opened, so that any batch is accessed in constant time.
+ * Raw batches are exposed as views straight into the mapping, while compressed batches are decoded.
+ */
+class BatchFile
+{
+  public:
+    /**
+     * @brief Map a batch file and read its header and index.
+     *
+     * @param inputFilename Name of the batch file.
+     */
+    BatchFile(const std::string &inputFilename);
+    BatchFile(const BatchFile &) = delete;
+    BatchFile &operator=(const BatchFile &) = delete;
+    ~BatchFile() noexcept;
+
+    /**
+     * @brief Observation parameters of the file; the number of batches is the number stored.
+     */
+    const Observation &getObservation() const;
+    /**
+     * @brief Padding used for cache aligning the batches.
+     */
+    unsigned int getPadding() const;
+    /**
+     * @brief Number of bits each sample is represented with.
+     */
+    uint8_t getInputBits() const;
+    /**
+     * @brief Number of batches stored in the file.
+     */
+    unsigned int getNrBatches() const;
+    /**
+     * @brief Size, in bytes, of one padded batch.
+     */
+    std::uint64_t getBatchSize() const;
+    /**
+     * @brief Index entry of a batch.
+     *
+     * @param batch The batch.
+     */
+    const BatchFileEntry &getEntry(const unsigned int batch) const;
+    /**
+     * @brief Pointer to a raw batch, straight into the mapping.
+     *
+     * @tparam T Data type of the batches.
+     * @param batch The batch.
+     */
+    template <typename T>
+    const T *getBatch(const unsigned int batch) const;
+    /**
+     * @brief Copy, or decode, a batch.
+     *
+     * @tparam T Data type of the batches.
+     * @param batch The batch.
+     * @param data Memory large enough for a padded batch.
+     */
+    template <typename T>
+    void readBatch(const unsigned int batch, T *data) const;
+
+  private:
+    void checkType(const std::size_t size) const;
+    void decode(const unsigned int batch, uint8_t *data) const;
+
+    Observation observation;
+    unsigned int padding;
+    uint8_t inputBits;
+    std::uint32_t elementSize;
+    std::uint64_t batchSize;
+    char *mapping;
+    std::uint64_t mappingSize;
+    std::vector<BatchFileEntry> index;
+};
+
+/**
+ * @brief Split items in bit planes; plane i contains the bit i of every item.
+ *
+ * @param input The items.
+ * @param output Memory of the same size of the input.
+ * @param itemSize Size, in bytes, of an item.
+ * @param nrItems Number of items, a multiple of eight.
+ */
+void bitshuffle(const uint8_t *input, uint8_t *output, const std::size_t itemSize, const std::uint64_t nrItems);
+/**
+ * @brief Rebuild the items from their bit planes; the reverse of bitshuffle.
+ *
+ * @param input The bit planes.
+ * @param output Memory of the same size of the input.
+ * @param itemSize Size, in bytes, of an item.
+ * @param nrItems Number of items, a multiple of eight.
+ */
+void bitunshuffle(const uint8_t *input, uint8_t *output, const std::size_t itemSize, const std::uint64_t nrItems);
+/**
+ * @brief Run-length encode bytes; literal sequences and runs of equal bytes are preceded by a control byte.
+ *
+ * @param input The bytes to encode.
+ * @param size Number of bytes to encode.
+ * @param output Memory for the encoded bytes.
+ * @param maxSize Size, in bytes, of the output memory.
+ * @return Number of encoded bytes, or zero if they do not fit in the output.
+ */
+std::uint64_t encodeRLE(const uint8_t *input, const std::uint64_t size, uint8_t *output, const std::uint64_t maxSize);
+/**
+ * @brief Decode run-length encoded bytes; the reverse of encodeRLE.
+ *
+ * @param input The encoded bytes.
+ * @param size Number of encoded bytes.
+ * @param output Memory for the decoded bytes.
+ * @param outputSize Expected number of decoded bytes.
+ */
+void decodeRLE(const uint8_t *input, const std::uint64_t size, uint8_t *output, const std::uint64_t outputSize);
+/**
+ * @brief Serialize the observation parameters.
+ *
+ * @param observation The observation.
+ * @return The serialized parameters.
+ */
+std::vector<char> serializeObservation(const Observation &observation);
+/**
+ * @brief Deserialize the observation parameters; the reverse of serializeObservation.
+ *
+ * @param buffer The serialized parameters.
+ * @param size Size, in bytes, of the serialized parameters.
+ * @param observation Object to populate with the observation parameters.
+ */
+void deserializeObservation(const char *buffer, const std::uint64_t size, Observation &observation);
+/**
+ * @brief Create the header page of a batch file.
+ *
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param elementSize Size, in bytes, of the data type of the batches.
+ * @param batchSize Size, in bytes, of one padded batch.
+ * @param nrBatches Number of batches in the file.
+ * @param indexOffset Offset, in bytes, of the index in the file.
+ * @return The header page.
+ */
+std::vector<char> getBatchFileHeader(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint32_t elementSize, const std::uint64_t batchSize, const unsigned int nrBatches, const std::uint64_t indexOffset);
+
+// Implementations
+
+template <typename T>
+BatchFileWriter<T>::BatchFileWriter(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::string &outputFilename, const BatchEncoding encoding) : observation(observation), padding(padding), inputBits(inputBits), encoding(encoding), outputFile(-1), offset(batchFileAlignment)
+{
+    batchSize = getPaddedBatchSize<T>(observation, padding, inputBits) * sizeof(T);
+    outputFile = open(outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outputFile < 0)
+    {
+        throw FileError("ERROR: impossible to open batch file \"" + outputFilename + "\".");
+    }
+    // The header is completed on close, once the number of batches is known
+    std::vector<char> header = getBatchFileHeader(observation, padding, inputBits, sizeof(T), batchSize, 0, 0);
+    writeFileAt(outputFile, header.data(), header.size(), 0);
+    if (encoding == BatchEncoding::BitshuffleRLE)
+    {
+        buffers.reset(2, batchSize, padding);
+    }
+}
+
+template <typename T>
+BatchFileWriter<T>::~BatchFileWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // Destructors must not throw; call close() to be notified of errors
+    }
+}
+
+template <typename T>
+void BatchFileWriter<T>::write(const T *data)
+{
+    BatchFileEntry entry = {offset, batchSize, BatchEncoding::Raw, 0};
+    const uint8_t *chunk = reinterpret_cast<const uint8_t *>(data);
+
+    if (outputFile < 0)
+    {
+        throw FileError("ERROR: the batch file is closed.");
+    }
+    if ((encoding == BatchEncoding::BitshuffleRLE) && ((batchSize / sizeof(T)) % 8 == 0))
+    {
+        bitshuffle(chunk, buffers.getSlot(0), sizeof(T), batchSize / sizeof(T));
+        // Encoded batches that are not smaller than raw ones are not worth decoding
+        const std::uint64_t encodedSize = encodeRLE(buffers.getSlot(0), batchSize, buffers.getSlot(1), batchSize - 1);
+        if (encodedSize > 0)
+        {
+            entry.size = encodedSize;
+            entry.encoding = BatchEncoding::BitshuffleRLE;
+            chunk = buffers.getSlot(1);
+        }
+    }
+    writeFileAt(outputFile, chunk, entry.size, entry.offset);
+    index.push_back(entry);
+    offset = isa::utils::pad(offset + entry.size, batchFileAlignment);
+}
+
+template <typename T>
+inline void BatchFileWriter<T>::write(const std::vector<T> &data)
+{
+    write(data.data());
+}
+
+template <typename T>
+void BatchFileWriter<T>::close()
+{
+    if (outputFile < 0)
+    {
+        return;
+    }
+    const int file = outputFile;
+    outputFile = -1;
+    try
+    {
+        std::vector<char> header = getBatchFileHeader(observation, padding, inputBits, sizeof(T), batchSize, index.size(), offset);
+
+        writeFileAt(file, index.data(), index.size() * sizeof(BatchFileEntry), offset);
+        writeFileAt(file, header.data(), header.size(), 0);
+    }
+    catch (...)
+    {
+        ::close(file);
+        throw;
+    }
+    ::close(file);
+}
+
+template <typename T>
+inline unsigned int BatchFileWriter<T>::getNrBatches() const
+{
+    return index.size();
+}
+
+inline const Observation &BatchFile::getObservation() const
+{
+    return observation;
+}
+
+inline unsigned int BatchFile::getPadding() const
+{
+    return padding;
+}
+
+inline uint8_t BatchFile::getInputBits() const
+{
+    return inputBits;
+}
+
+inline unsigned int BatchFile::getNrBatches() const
+{
+    return index.size();
+}
+
+inline std::uint64_t BatchFile::getBatchSize() const
+{
+    return batchSize;
+}
+
+template <typename T>
+const T *BatchFile::getBatch(const unsigned int batch) const
+{
+    checkType(sizeof(T));
+    if (getEntry(batch).encoding != BatchEncoding::Raw)
+    {
+        throw FileError("ERROR: batch " + std::to_string(batch) + " is compressed and cannot be accessed in place.");
+    }
+    return reinterpret_cast<const T *>(mapping + index.at(batch).offset);
+}
+
+template <typename T>
+void BatchFile::readBatch(const unsigned int batch, T *data) const
+{
+    checkType(sizeof(T));
+    decode(batch, reinterpret_cast<uint8_t *>(data));
+}
+
+} // namespace AstroData
@@ -0,0 +1,153 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "Observation.hpp"
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief Deliver dispersed batches, i.e. a batch followed by the delay batches it needs, from a ring of batches.
+ *
+ * The ring contains the observation's number of delay batches. Every call of next() drops the oldest batch
+ * and reads only the new one into its buffer, so that consecutive dispersed batches share their overlap
+ * without reading or copying it again:
+ *
+ * @code
+ * AstroData::SIGPROCStream<uint8_t> stream(observation, padding, 8, filename);
+ * AstroData::DispersedBatchRing<uint8_t> ring([&stream](std::vector<uint8_t> *data) { return stream.next(data); }, observation, padding);
+ * while ( ring.next() ) { process(ring.getBatches()); }
+ * @endcode
+ *
+ * The ring works for samples of at least 8 bits, in padded channel-major layout.
+ *
+ * @tparam T Data type of the batches.
+ */
+template <typename T>
+class DispersedBatchRing
+{
+  public:
+    /**
+     * @brief Allocate the ring.
+     *
+     * @param source Function that reads the next batch into a buffer, and returns false when there are no more batches.
+     * @param observation Object containing the observation parameters, including the number of delay batches.
+     * @param padding Padding used for cache aligning.
+     * @param subbanding Use the number of delay batches of the subbanding step.
+     */
+    DispersedBatchRing(const std::function<bool(std::vector<T> *)> &source, const Observation &observation, const unsigned int padding, const bool subbanding = false);
+    DispersedBatchRing(const DispersedBatchRing &) = delete;
+    DispersedBatchRing &operator=(const DispersedBatchRing &) = delete;
+
+    /**
+     * @brief Move to the next dispersed batch, reading one new batch from the source.
+     * The first call reads all the batches of the first dispersed batch.
+     *
+     * @return False if the source cannot complete the next dispersed batch, true otherwise.
+     */
+    bool next();
+    /**
+     * @brief Index of the first batch of the current dispersed batch.
+     */
+    unsigned int getBatch() const;
+    /**
+     * @brief The batches of the current dispersed batch, in order.
+     */
+    const std::vector<const T *> &getBatches() const;
+    /**
+     * @brief One item of the current dispersed batch.
+     * Convenient but not fast; loops should use getBatches() instead.
+     *
+     * @param channel The channel.
+     * @param sample The sample, counted from the beginning of the dispersed batch.
+     */
+    T at(const unsigned int channel, const unsigned int sample) const;
+
+  private:
+    std::function<bool(std::vector<T> *)> source;
+    unsigned int nrSamplesPerBatch;
+    unsigned int nrPaddedSamples;
+    std::vector<std::vector<T>> buffers;
+    std::vector<const T *> batches;
+    unsigned int firstBuffer;
+    unsigned int nrFilled;
+    unsigned int batch;
+    bool endOfData;
+};
+
+// Implementations
+
+template <typename T>
+DispersedBatchRing<T>::DispersedBatchRing(const std::function<bool(std::vector<T> *)> &source, const Observation &observation, const unsigned int padding, const bool subbanding) : source(source), nrSamplesPerBatch(observation.getNrSamplesPerBatch()), nrPaddedSamples(observation.getNrSamplesPerBatch(false, padding / sizeof(T))), firstBuffer(0), nrFilled(0), batch(0), endOfData(false)
+{
+    const unsigned int nrDelayBatches = std::max(observation.getNrDelayBatches(subbanding), 1u);
+
+    buffers.resize(nrDelayBatches, std::vector<T>(static_cast<std::size_t>(observation.getNrChannels()) * nrPaddedSamples));
+    batches.resize(nrDelayBatches);
+}
+
+template <typename T>
+bool DispersedBatchRing<T>::next()
+{
+    if (endOfData)
+    {
+        return false;
+    }
+    if (nrFilled == buffers.size())
+    {
+        firstBuffer = (firstBuffer + 1) % buffers.size();
+        nrFilled--;
+        batch++;
+    }
+    while (nrFilled < buffers.size())
+    {
+        if (!source(&buffers.at((firstBuffer + nrFilled) % buffers.size())))
+        {
+            endOfData = true;
+            return false;
+        }
+        nrFilled++;
+    }
+    for (unsigned int delayBatch = 0; delayBatch < buffers.size(); delayBatch++)
+    {
+        batches.at(delayBatch) = buffers.at((firstBuffer + delayBatch) % buffers.size()).data();
+    }
+    return true;
+}
+
+template <typename T>
+inline unsigned int DispersedBatchRing<T>::getBatch() const
+{
+    return batch;
+}
+
+template <typename T>
+inline const std::vector<const T *> &DispersedBatchRing<T>::getBatches() const
+{
+    return batches;
+}
+
+template <typename T>
+inline T DispersedBatchRing<T>::at(const unsigned int channel, const unsigned int sample) const
+{
+    return batches.at(sample / nrSamplesPerBatch)[(static_cast<std::size_t>(channel) * nrPaddedSamples) + (sample % nrSamplesPerBatch)];
+}
+
+} // namespace AstroData
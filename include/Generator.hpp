@@ -14,154 +14,352 @@
 // limitations under the License.
 
 #include <vector>
-#include <cstdlib>
-#include <ctime>
-#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <cstring>
+#include <limits>
 #include <algorithm>
 
 #include "Observation.hpp"
+#include "BatchArena.hpp"
+#include "Platform.hpp"
 
 
 #pragma once
 
 namespace AstroData {
 
-template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const bool random = false);
-template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits, const bool random = false);
+// Counter-based random numbers: a number depends only on the key and its counter, never on the order in which numbers are drawn,
+// so that the same seed gives the same data with any number of threads. Keys of different streams are independent.
+inline std::uint64_t mixBits(std::uint64_t value);
+inline std::uint64_t getRandomKey(const std::uint64_t seed, const std::uint64_t stream);
+inline std::uint64_t getRandomNumber(const std::uint64_t key, const std::uint64_t counter);
+
+// Word with all the packed items of inputBits bits (1, 2 or 4) set to value
+inline std::uint64_t replicatePackedItem(const std::uint8_t value, const std::uint8_t inputBits);
+
+// Random streams of the generators
+enum class RandomStream : std::uint64_t { Noise = 1, Pulse = 2, Position = 3 };
+
+// The generators are deterministic for a given seed; rows of the batches are generated in parallel on nrThreads threads (0 for all hardware threads)
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, AstroData::BatchArena< T > & data, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, AstroData::BatchArena< T > & data, const uint8_t inputBits, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const uint8_t inputBits, const bool random = false, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+
+// Dispersed pulse, single or periodic, injected by injectPulses and SyntheticStream
+struct SyntheticPulse {
+  // Beam containing the pulse; injectPulses works on the batches of a single beam and ignores it
+  unsigned int beam = 0;
+  // Dispersion measure
+  float DM = 0.0f;
+  // Sample, from the start of the observation, of the arrival at the highest frequency
+  std::uint64_t sample = 0;
+  // Width, in samples
+  unsigned int width = 1;
+  // Period, in samples; zero for a single pulse
+  unsigned int period = 0;
+  // Total value added to each channel, spread evenly over the width of the pulse
+  float fluence = 0.0f;
+};
+
+// Delay, in samples, of a pulse in a channel; channelDelay is the one of Observation::getChannelDelays(), and the delay is zero without a sampling time
+inline std::uint64_t getPulseDelay(const float channelDelay, const float DM, const AstroData::Observation & observation);
+// Call add(sample, amplitude) for every sample, in [firstSample, lastSample), covered by the pulse in a channel with the given delay
+template< typename F > void injectPulse(const SyntheticPulse & pulse, const std::uint64_t delay, const std::uint64_t firstSample, const std::uint64_t lastSample, F add);
+// Value plus amplitude, saturating at minValue and maxValue
+inline double addSaturated(const double value, const double amplitude, const double minValue, const double maxValue);
+// Add the pulses to already loaded batches, starting from batch firstBatch of the observation, saturating at the limits of the data type.
+// Only the samples covered by the pulses are touched; packed data (inputBits < 8) is read, modified and written back one item at a time.
+template< typename T > void injectPulses(const std::vector< SyntheticPulse > & pulses, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits = 8, const unsigned int firstBatch = 0, const unsigned int nrThreads = 1);
+template< typename T > void injectPulses(const std::vector< SyntheticPulse > & pulses, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const uint8_t inputBits = 8, const unsigned int firstBatch = 0, const unsigned int nrThreads = 1);
 
 // Implementations
-template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const bool random) {
-  std::srand(std::time(0));
-  // Generate the  "noise"
+inline std::uint64_t mixBits(std::uint64_t value) {
+  // SplitMix64 finalizer
+  value += 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+inline std::uint64_t getRandomKey(const std::uint64_t seed, const std::uint64_t stream) {
+  return mixBits(seed ^ mixBits(stream));
+}
+
+inline std::uint64_t getRandomNumber(const std::uint64_t key, const std::uint64_t counter) {
+  return mixBits(key + (counter * 0x9E3779B97F4A7C15ULL));
+}
+
+inline std::uint64_t replicatePackedItem(const std::uint8_t value, const std::uint8_t inputBits) {
+  const std::uint64_t mask = (1 << inputBits) - 1;
+
+  // All ones divided by the item mask has the lowest bit of every item set
+  return (value & mask) * (~0ULL / mask);
+}
+
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  std::vector< T * > batches(observation.getNrBatches());
+
   for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ ) {
     data[batch] = new std::vector< T >(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)));
+    batches[batch] = data[batch]->data();
+  }
+  generatePulsar(period, width, DM, observation, padding, batches, random, seed, nrThreads);
+}
+
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, AstroData::BatchArena< T > & data, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  data.reset(observation.getNrBatches(), observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)), padding);
+  generatePulsar(period, width, DM, observation, padding, data.getSlots(), random, seed, nrThreads);
+}
+
+template< typename T > void generatePulsar(const unsigned int period, const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  const std::uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+  const std::uint64_t nrSamples = static_cast< std::uint64_t >(observation.getNrBatches()) * observation.getNrSamplesPerBatch();
+  const std::uint64_t noiseKey = getRandomKey(seed, static_cast< std::uint64_t >(RandomStream::Noise));
+  const std::uint64_t pulseKey = getRandomKey(seed, static_cast< std::uint64_t >(RandomStream::Pulse));
+
+  // Generate the  "noise", one channel of one batch at a time
+  parallelFor(nrThreads, static_cast< std::uint64_t >(observation.getNrBatches()) * observation.getNrChannels(), [&](const std::uint64_t row) {
+    T * rowData = data[row / observation.getNrChannels()] + ((row % observation.getNrChannels()) * nrPaddedSamples);
+
     if ( random ) {
-      for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ ) {
-        for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
-          data[batch]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + sample) = static_cast< T >(std::rand() % 25);
-        }
+      std::fill(rowData + observation.getNrSamplesPerBatch(), rowData + nrPaddedSamples, static_cast< T >(0));
+      for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
+        rowData[sample] = static_cast< T >(getRandomNumber(noiseKey, (row * observation.getNrSamplesPerBatch()) + sample) % 25);
       }
     } else {
-      std::fill(data[batch]->begin(), data[batch]->end(), static_cast< T >(8));
+      std::fill(rowData, rowData + nrPaddedSamples, static_cast< T >(8));
     }
-  }
-  // Generate the pulsar
-  float inverseHighFreq = 1.0f / (observation.getMaxFreq() * observation.getMaxFreq());
-  float kDM = 4148.808f * DM;
-  for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ ) {
-    float inverseFreq = 1.0f / ((observation.getMinFreq() + (channel * observation.getChannelBandwidth())) * (observation.getMinFreq() + (channel * observation.getChannelBandwidth())));
-    float delta = kDM * (inverseFreq - inverseHighFreq);
-    unsigned int shift = static_cast< unsigned int >(delta * observation.getNrSamplesPerBatch());
-
-    for ( unsigned int sample = shift; sample < observation.getNrBatches() * observation.getNrSamplesPerBatch(); sample += period ) {
+  });
+  // Generate the pulsar, one channel at a time
+  std::shared_ptr< const std::vector< float > > channelDelays = observation.getChannelDelays();
+  parallelFor(nrThreads, observation.getNrChannels(), [&](const std::uint64_t channel) {
+    unsigned int shift = static_cast< unsigned int >(channelDelays->at(channel) * DM * observation.getNrSamplesPerBatch());
+
+    for ( std::uint64_t sample = shift; sample < nrSamples; sample += period ) {
       for ( unsigned int i = 0; i < width; i++ ) {
-        if ( sample + i >= observation.getNrBatches() * observation.getNrSamplesPerBatch() ) {
+        if ( sample + i >= nrSamples ) {
         break;
         }
         unsigned int batch = (sample + i) / observation.getNrSamplesPerBatch();
         unsigned int internalSample = (sample + i) % observation.getNrSamplesPerBatch();
 
         if ( random ) {
-          data[batch]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + internalSample) = static_cast< T >(std::rand() % 128);
+          data[batch][(channel * nrPaddedSamples) + internalSample] = static_cast< T >(getRandomNumber(pulseKey, (channel * nrSamples) + sample + i) % 128);
         } else {
-          data[batch]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + internalSample) = static_cast< T >(42);
+          data[batch][(channel * nrPaddedSamples) + internalSample] = static_cast< T >(42);
         }
       }
     }
-  }
+  });
 }
 
-template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits, const bool random) {
-  std::srand(std::time(0));
-  // Generate the  "noise"
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  std::vector< T * > batches(observation.getNrBatches());
+
   for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ ) {
     if ( inputBits >= 8 ) {
       data[batch] = new std::vector< T >(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)));
     } else {
       data[batch] = new std::vector< T >(observation.getNrChannels() * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T)));
     }
+    batches[batch] = data[batch]->data();
+  }
+  generateSinglePulse(width, DM, observation, padding, batches, inputBits, random, seed, nrThreads);
+}
+
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, AstroData::BatchArena< T > & data, const uint8_t inputBits, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  if ( inputBits >= 8 ) {
+    data.reset(observation.getNrBatches(), observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)), padding);
+  } else {
+    data.reset(observation.getNrBatches(), observation.getNrChannels() * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T)), padding);
+  }
+  generateSinglePulse(width, DM, observation, padding, data.getSlots(), inputBits, random, seed, nrThreads);
+}
+
+template< typename T > void generateSinglePulse(const unsigned int width, const float DM, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const uint8_t inputBits, const bool random, const std::uint64_t seed, const unsigned int nrThreads) {
+  const std::uint64_t noiseKey = getRandomKey(seed, static_cast< std::uint64_t >(RandomStream::Noise));
+  const std::uint64_t pulseKey = getRandomKey(seed, static_cast< std::uint64_t >(RandomStream::Pulse));
+  const std::uint64_t positionKey = getRandomKey(seed, static_cast< std::uint64_t >(RandomStream::Position));
+  std::uint64_t nrRowItems = 0;
+
+  if ( inputBits >= 8 ) {
+    nrRowItems = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+  } else {
+    nrRowItems = isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T));
+  }
+  // Packed items are replaced inside their byte
+  auto setItem = [inputBits](T & byte, const unsigned int sample, const std::uint8_t value) {
+    std::uint8_t firstBit = (sample % (8 / inputBits)) * inputBits;
+    std::uint8_t mask = ((1 << inputBits) - 1) << firstBit;
+
+    byte = static_cast< T >((static_cast< std::uint8_t >(byte) & ~mask) | ((value << firstBit) & mask));
+  };
+  // Generate the  "noise", one channel of one batch at a time
+  parallelFor(nrThreads, static_cast< std::uint64_t >(observation.getNrBatches()) * observation.getNrChannels(), [&](const std::uint64_t row) {
+    T * rowData = data[row / observation.getNrChannels()] + ((row % observation.getNrChannels()) * nrRowItems);
+
     if ( random ) {
-      for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ ) {
+      if ( inputBits >= 8 ) {
+        std::fill(rowData + observation.getNrSamplesPerBatch(), rowData + nrRowItems, static_cast< T >(0));
         for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ ) {
-          if ( inputBits >= 8 ) {
-            data[batch]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + sample) = static_cast< T >(std::rand() % 25);
-          } else {
-            unsigned int byte = sample / (8 / inputBits);
-            uint8_t firstBit = (sample % (8 / inputBits)) * inputBits;
-            uint8_t value = static_cast< unsigned int >(std::rand() % (inputBits - 1));
-            unsigned char buffer = data[batch]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte);
-
-            for ( uint8_t bit = 0; bit < inputBits; bit++ ) {
-              isa::utils::setBit(buffer, isa::utils::getBit(value, bit), firstBit + bit);
-            }
-            data[batch]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte) = buffer;
-          }
+          rowData[sample] = static_cast< T >(getRandomNumber(noiseKey, (row * observation.getNrSamplesPerBatch()) + sample) % 25);
+        }
+      } else {
+        // Noise uses the lower half of the range of values, so eight bytes of items are one random word with the highest bit of every item cleared
+        const std::uint64_t noiseMask = replicatePackedItem((1 << (inputBits - 1)) - 1, inputBits);
+        const std::uint64_t nrBytes = observation.getNrSamplesPerBatch() / (8 / inputBits);
+        const std::uint64_t nrWords = (nrBytes + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+        std::uint64_t word = 0;
+
+        // Padding is cleared too, so that the whole batch depends only on the seed
+        std::fill(rowData + nrBytes, rowData + nrRowItems, static_cast< T >(0));
+        for ( ; (word + 1) * sizeof(std::uint64_t) <= nrBytes; word++ ) {
+          std::uint64_t value = getRandomNumber(noiseKey, (row * nrWords) + word) & noiseMask;
+
+          std::memcpy(rowData + (word * sizeof(std::uint64_t)), &value, sizeof(std::uint64_t));
+        }
+        if ( word < nrWords ) {
+          std::uint64_t value = getRandomNumber(noiseKey, (row * nrWords) + word) & noiseMask;
+
+          std::memcpy(rowData + (word * sizeof(std::uint64_t)), &value, nrBytes - (word * sizeof(std::uint64_t)));
         }
       }
     } else {
       if ( inputBits >= 8 ) {
-        std::fill(data[batch]->begin(), data[batch]->end(), static_cast< T >(8));
+        std::fill(rowData, rowData + nrRowItems, static_cast< T >(8));
       } else {
-        std::fill(data[batch]->begin(), data[batch]->end(), static_cast< T >(0));
+        std::fill(rowData, rowData + nrRowItems, static_cast< T >(0));
       }
     }
-  }
+  });
   // Generate the pulse
   unsigned int batch = 0;
   unsigned int sample = 0;
-  float inverseHighFreq = 1.0f / std::pow(observation.getMaxFreq(), 2.0f);
-  float kDM = 4148.808f * DM;
+  std::shared_ptr< const std::vector< float > > channelDelays = observation.getChannelDelays();
 
   if ( random ) {
-    batch = std::rand() % (observation.getNrBatches() / 2);
-    sample = std::rand() % (observation.getNrSamplesPerBatch() - width);
+    batch = getRandomNumber(positionKey, 0) % std::max(observation.getNrBatches() / 2, 1u);
+    sample = getRandomNumber(positionKey, 1) % (observation.getNrSamplesPerBatch() - width);
   } else {
     batch = observation.getNrBatches() / 2;
     sample = observation.getNrSamplesPerBatch() / 2;
   }
+  parallelFor(nrThreads, observation.getNrChannels(), [&](const std::uint64_t channel) {
+    unsigned int shift = static_cast< unsigned int >(channelDelays->at(channel) * DM * observation.getNrSamplesPerBatch());
 
-  for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ ) {
-    float inverseFreq = 1.0f / std::pow(observation.getMinFreq() + (channel * observation.getChannelBandwidth()), 2.0f);
-    unsigned int shift = static_cast< unsigned int >(kDM * (inverseFreq - inverseHighFreq) * observation.getNrSamplesPerBatch());
-
-    for ( unsigned int i = 0; i < width; i++ ) {
+    for ( unsigned int i = 0; i < width; ) {
       if ( batch + ((sample + i + shift) / observation.getNrSamplesPerBatch()) >= observation.getNrBatches() ) {
       break;
       }
+      T * rowData = data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())] + (channel * nrRowItems);
+      unsigned int internalSample = (sample + i + shift) % observation.getNrSamplesPerBatch();
 
-      if ( random ) {
-        if ( inputBits >= 8 ) {
-          data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + (sample + i + shift)) = static_cast< T >(std::rand() % 256);
+      if ( inputBits >= 8 ) {
+        if ( random ) {
+          rowData[internalSample] = static_cast< T >(getRandomNumber(pulseKey, (channel * width) + i) % 256);
+        } else {
+          rowData[internalSample] = static_cast< T >(42);
+        }
+        i++;
+      } else if ( (internalSample % (8 / inputBits) == 0) && (i + (8 / inputBits) <= width) ) {
+        // Whole bytes of the pulse are written at once
+        if ( random ) {
+          rowData[internalSample / (8 / inputBits)] = static_cast< T >(getRandomNumber(pulseKey, (channel * width) + i) & 0xff);
         } else {
-          uint8_t value = static_cast< unsigned int >(std::rand() % inputBits);
-          unsigned int byte = ((sample + i + shift) % observation.getNrSamplesPerBatch()) / (8 / inputBits);
-          uint8_t firstBit = (((sample + i + shift) % observation.getNrSamplesPerBatch()) % (8 / inputBits)) * inputBits;
-          unsigned char buffer = data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte);
-
-          for ( uint8_t bit = 0; bit < inputBits; bit++ ) {
-            isa::utils::setBit(buffer, isa::utils::getBit(value, bit), firstBit + bit);
-          }
-          data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte) = buffer;
+          rowData[internalSample / (8 / inputBits)] = static_cast< T >(replicatePackedItem(inputBits, inputBits) & 0xff);
         }
+        i += 8 / inputBits;
       } else {
-        if ( inputBits >= 8 ) {
-          data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + ((sample + i + shift) % observation.getNrSamplesPerBatch())) = static_cast< T >(42);
+        if ( random ) {
+          setItem(rowData[internalSample / (8 / inputBits)], internalSample, getRandomNumber(pulseKey, (channel * width) + i) % (1 << inputBits));
         } else {
-          unsigned int byte = ((sample + i + shift) % observation.getNrSamplesPerBatch()) / (8 / inputBits);
-          uint8_t firstBit = (((sample + i + shift) % observation.getNrSamplesPerBatch()) % (8 / inputBits)) * inputBits;
-          unsigned char buffer = 0;
-
-          buffer = data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte);
-
-          for ( uint8_t bit = 0; bit < inputBits; bit++ ) {
-            isa::utils::setBit(buffer, isa::utils::getBit(inputBits, bit), firstBit + bit);
-          }
-          data[batch + ((sample + i + shift) / observation.getNrSamplesPerBatch())]->at((channel * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + byte) = buffer;
+          setItem(rowData[internalSample / (8 / inputBits)], internalSample, inputBits);
         }
+        i++;
       }
     }
+  });
+}
+
+inline std::uint64_t getPulseDelay(const float channelDelay, const float DM, const AstroData::Observation & observation) {
+  if ( observation.getSamplingTime() <= 0.0f ) {
+    return 0;
   }
+  return static_cast< std::uint64_t >(static_cast< double >(channelDelay) * DM / observation.getSamplingTime());
 }
 
-} // AstroData
+template< typename F > void injectPulse(const SyntheticPulse & pulse, const std::uint64_t delay, const std::uint64_t firstSample, const std::uint64_t lastSample, F add) {
+  const double amplitude = pulse.fluence / pulse.width;
+  std::uint64_t arrival = pulse.sample + delay;
 
+  if ( (pulse.period > 0) && (arrival + pulse.width <= firstSample) ) {
+    // Skip the periods ending before firstSample
+    arrival += ((firstSample - (arrival + pulse.width)) / pulse.period + 1) * pulse.period;
+  }
+  while ( arrival < lastSample ) {
+    for ( std::uint64_t sample = std::max(arrival, firstSample); sample < std::min(arrival + pulse.width, lastSample); sample++ ) {
+      add(sample, amplitude);
+    }
+    if ( pulse.period == 0 ) {
+      break;
+    }
+    arrival += pulse.period;
+  }
+}
+
+inline double addSaturated(const double value, const double amplitude, const double minValue, const double maxValue) {
+  return std::max(std::min(value + amplitude, maxValue), minValue);
+}
+
+template< typename T > void injectPulses(const std::vector< SyntheticPulse > & pulses, const AstroData::Observation & observation, const unsigned int padding, std::vector< std::vector< T > * > & data, const uint8_t inputBits, const unsigned int firstBatch, const unsigned int nrThreads) {
+  std::vector< T * > batches(data.size());
+
+  for ( unsigned int batch = 0; batch < data.size(); batch++ ) {
+    batches[batch] = data[batch]->data();
+  }
+  injectPulses(pulses, observation, padding, batches, inputBits, firstBatch, nrThreads);
+}
+
+template< typename T > void injectPulses(const std::vector< SyntheticPulse > & pulses, const AstroData::Observation & observation, const unsigned int padding, const std::vector< T * > & data, const uint8_t inputBits, const unsigned int firstBatch, const unsigned int nrThreads) {
+  const std::uint64_t firstSample = static_cast< std::uint64_t >(firstBatch) * observation.getNrSamplesPerBatch();
+  const std::uint64_t lastSample = firstSample + (static_cast< std::uint64_t >(data.size()) * observation.getNrSamplesPerBatch());
+  std::shared_ptr< const std::vector< float > > channelDelays = observation.getChannelDelays();
+  std::uint64_t nrRowItems = 0;
+  double minValue = 0.0;
+  double maxValue = 0.0;
+
+  if ( inputBits >= 8 ) {
+    nrRowItems = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+    minValue = static_cast< double >(std::numeric_limits< T >::lowest());
+    maxValue = static_cast< double >(std::numeric_limits< T >::max());
+  } else {
+    nrRowItems = isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T));
+    maxValue = (1 << inputBits) - 1;
+  }
+  // Channels are independent, so every thread writes to its own rows, packed bytes included
+  parallelFor(nrThreads, observation.getNrChannels(), [&](const std::uint64_t channel) {
+    for ( const auto & pulse : pulses ) {
+      injectPulse(pulse, getPulseDelay(channelDelays->at(channel), pulse.DM, observation), firstSample, lastSample, [&](const std::uint64_t sample, const double amplitude) {
+        const unsigned int internalSample = sample % observation.getNrSamplesPerBatch();
+        T * rowData = data[(sample - firstSample) / observation.getNrSamplesPerBatch()] + (channel * nrRowItems);
+
+        if ( inputBits >= 8 ) {
+          rowData[internalSample] = static_cast< T >(addSaturated(static_cast< double >(rowData[internalSample]), amplitude, minValue, maxValue));
+        } else {
+          T & byte = rowData[internalSample / (8 / inputBits)];
+          const std::uint8_t firstBit = (internalSample % (8 / inputBits)) * inputBits;
+          const std::uint8_t mask = ((1 << inputBits) - 1) << firstBit;
+          const double value = addSaturated((static_cast< std::uint8_t >(byte) & mask) >> firstBit, amplitude, minValue, maxValue);
+
+          byte = static_cast< T >((static_cast< std::uint8_t >(byte) & ~mask) | ((static_cast< std::uint8_t >(value) << firstBit) & mask));
+        }
+      });
+    }
+  });
+}
+
+} // AstroData
@@ -0,0 +1,192 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstring>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif // __F16C__
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief IEEE 754 half precision value, used to store batches in half the memory of single precision.
+ * It is a storage type only, values are converted to single precision for computation.
+ */
+struct half
+{
+    std::uint16_t bits;
+};
+
+/**
+ * @brief Convert a single precision value to half precision, rounding to the nearest value.
+ *
+ * @param value The single precision value.
+ * @return The half precision value.
+ */
+inline half floatToHalf(const float value);
+/**
+ * @brief Convert a half precision value to single precision; the conversion is exact.
+ *
+ * @param value The half precision value.
+ * @return The single precision value.
+ */
+inline float halfToFloat(const half value);
+/**
+ * @brief Convert single precision values to half precision; eight values at a time if F16C is available.
+ *
+ * @param input The single precision values.
+ * @param output The half precision values.
+ * @param nrItems Number of values to convert.
+ */
+inline void floatToHalf(const float *input, half *output, const std::uint64_t nrItems);
+/**
+ * @brief Convert half precision values to single precision; eight values at a time if F16C is available.
+ *
+ * @param input The half precision values.
+ * @param output The single precision values.
+ * @param nrItems Number of values to convert.
+ */
+inline void halfToFloat(const half *input, float *output, const std::uint64_t nrItems);
+
+// Implementations
+
+inline half floatToHalf(const float value)
+{
+#ifdef __F16C__
+    return half{static_cast<std::uint16_t>(_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT))};
+#else
+    std::uint32_t word = 0;
+
+    std::memcpy(&word, &value, sizeof(word));
+    const std::uint16_t sign = (word >> 16) & 0x8000;
+    const int exponent = static_cast<int>((word >> 23) & 0xff) - 127 + 15;
+    std::uint32_t mantissa = word & 0x007fffff;
+
+    if (((word >> 23) & 0xff) == 0xff)
+    {
+        // Infinity stays infinity, and NaN stays NaN
+        return half{static_cast<std::uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x0200 | (mantissa >> 13) : 0))};
+    }
+    if (exponent >= 0x1f)
+    {
+        return half{static_cast<std::uint16_t>(sign | 0x7c00)};
+    }
+    if (exponent <= 0)
+    {
+        // Subnormal half precision values, or zero
+        if (exponent < -10)
+        {
+            return half{sign};
+        }
+        mantissa |= 0x00800000;
+        const unsigned int shift = 14 - exponent;
+        const std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const std::uint32_t halfway = 1u << (shift - 1);
+        std::uint32_t result = mantissa >> shift;
+
+        if ((remainder > halfway) || ((remainder == halfway) && ((result & 1) != 0)))
+        {
+            result++;
+        }
+        return half{static_cast<std::uint16_t>(sign | result)};
+    }
+    // A carry out of the mantissa correctly increments the exponent, up to infinity
+    const std::uint32_t remainder = mantissa & 0x1fff;
+    std::uint32_t result = (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13);
+
+    if ((remainder > 0x1000) || ((remainder == 0x1000) && ((result & 1) != 0)))
+    {
+        result++;
+    }
+    return half{static_cast<std::uint16_t>(sign | result)};
+#endif // __F16C__
+}
+
+inline float halfToFloat(const half value)
+{
+#ifdef __F16C__
+    return _cvtsh_ss(value.bits);
+#else
+    const std::uint32_t sign = static_cast<std::uint32_t>(value.bits & 0x8000) << 16;
+    const std::uint32_t exponent = (value.bits >> 10) & 0x1f;
+    std::uint32_t mantissa = value.bits & 0x03ff;
+    std::uint32_t word = 0;
+    float result = 0.0f;
+
+    if (exponent == 0x1f)
+    {
+        word = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        word = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // Subnormal half precision values are normal in single precision
+        int normalExponent = 1;
+
+        while ((mantissa & 0x0400) == 0)
+        {
+            mantissa <<= 1;
+            normalExponent--;
+        }
+        word = sign | (static_cast<std::uint32_t>(normalExponent + 112) << 23) | ((mantissa & 0x03ff) << 13);
+    }
+    else
+    {
+        word = sign;
+    }
+    std::memcpy(&result, &word, sizeof(result));
+    return result;
+#endif // __F16C__
+}
+
+inline void floatToHalf(const float *input, half *output, const std::uint64_t nrItems)
+{
+    std::uint64_t item = 0;
+
+#ifdef __F16C__
+    for (; item + 8 <= nrItems; item += 8)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + item), _mm256_cvtps_ph(_mm256_loadu_ps(input + item), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif // __F16C__
+    for (; item < nrItems; item++)
+    {
+        output[item] = floatToHalf(input[item]);
+    }
+}
+
+inline void halfToFloat(const half *input, float *output, const std::uint64_t nrItems)
+{
+    std::uint64_t item = 0;
+
+#ifdef __F16C__
+    for (; item + 8 <= nrItems; item += 8)
+    {
+        _mm256_storeu_ps(output + item, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + item))));
+    }
+#endif // __F16C__
+    for (; item < nrItems; item++)
+    {
+        output[item] = halfToFloat(input[item]);
+    }
+}
+
+} // namespace AstroData
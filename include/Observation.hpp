@@ -15,6 +15,8 @@
 
 #include <string>
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include <utils.hpp>
 
@@ -54,6 +56,11 @@ public:
   float getFirstDM(const bool subbanding = false) const;
   float getLastDM(const bool subbanding = false) const;
   float getDMStep(const bool subbanding = false) const;
+  // Dispersion delays, computed on first use and kept until the frequency range, DM range or sampling time changes; copies of the observation share them
+  // Delay, in seconds per unit of DM, of each channel with respect to the highest frequency channel
+  std::shared_ptr< const std::vector< float > > getChannelDelays() const;
+  // Delay, in samples of getSamplingTime() seconds, of each channel (rows) for each DM (columns, padded to a multiple of padding); zero if there is no sampling time
+  std::shared_ptr< const std::vector< unsigned int > > getDelays(const bool subbanding = false, const unsigned int padding = 0) const;
   // Periods
   unsigned int getNrPeriods(const unsigned int padding = 0) const;
   unsigned int getFirstPeriod() const;
@@ -114,6 +121,15 @@ private:
   float DMStep;
   float DMStep_subbanding;
 
+  struct DelayTable {
+    unsigned int padding;
+    std::vector< unsigned int > delays;
+  };
+  std::shared_ptr< const DelayTable > computeDelays(const bool subbanding, const unsigned int padding) const;
+  mutable std::shared_ptr< const std::vector< float > > channelDelays;
+  mutable std::shared_ptr< const DelayTable > delays;
+  mutable std::shared_ptr< const DelayTable > delays_subbanding;
+
   unsigned int nrPeriods;
   unsigned int firstPeriod;
   unsigned int lastPeriod;
@@ -202,6 +218,8 @@ inline void Observation::setNrSynthesizedBeams(const unsigned int beams) {
 
 inline void Observation::setSamplingTime(const float sampling) {
   samplingTime = sampling;
+  std::atomic_store(&delays, std::shared_ptr< const DelayTable >());
+  std::atomic_store(&delays_subbanding, std::shared_ptr< const DelayTable >());
 }
 
 inline void Observation::setNrZappedChannels(const unsigned int zappedChannels) {
@@ -16,6 +16,8 @@
 #include <string>
 #include <map>
 #include <fstream>
+#include <functional>
+#include <cstdint>
 
 #include <utils.hpp>
 
@@ -44,5 +46,9 @@ typedef std::map<std::string, unsigned int> vectorWidthConf;
 void readPaddingConf(paddingConf & padding, const std::string & paddingFilename);
 void readVectorWidthConf(vectorWidthConf & vectorWidth, const std::string & vectorFilename);
 
+// Run body(item) for all items in [0, nrItems) on nrThreads threads (0 for all hardware threads), the caller included.
+// Items are handed out dynamically; the first exception thrown by body stops the loop and is rethrown to the caller.
+void parallelFor(const unsigned int nrThreads, const std::uint64_t nrItems, const std::function< void(std::uint64_t) > & body);
+
 } // AstroData
 
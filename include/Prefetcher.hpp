@@ -0,0 +1,238 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief Read batches ahead of their use on a background I/O thread.
+ *
+ * The prefetcher owns a fixed pool of preallocated buffers. While the caller processes the batch it acquired,
+ * the I/O thread fills the other buffers with the following batches, using any of the readers as source:
+ *
+ * @code
+ * AstroData::SIGPROCStream<uint8_t> stream(observation, padding, 8, filename);
+ * AstroData::BatchPrefetcher<uint8_t> prefetcher([&stream](std::vector<uint8_t> *data) { return stream.next(data); }, batchSize, 3);
+ * @endcode
+ *
+ * @tparam T Data type of the batches.
+ */
+template <typename T>
+class BatchPrefetcher
+{
+  public:
+    /**
+     * @brief Allocate the buffers and start the I/O thread.
+     *
+     * @param source Function that reads the next batch into a buffer, and returns false when there are no more batches.
+     * @param bufferSize Number of elements of each buffer, including padding.
+     * @param nrBuffers Number of buffers in the pool; two for double buffering, three for triple buffering.
+     */
+    BatchPrefetcher(const std::function<bool(std::vector<T> *)> &source, const std::size_t bufferSize, const unsigned int nrBuffers = 2);
+    BatchPrefetcher(const BatchPrefetcher &) = delete;
+    BatchPrefetcher &operator=(const BatchPrefetcher &) = delete;
+    ~BatchPrefetcher();
+
+    /**
+     * @brief Wait for the next batch.
+     * Exceptions thrown by the source are rethrown here.
+     *
+     * @return The buffer containing the next batch, or a null pointer if there are no more batches.
+     */
+    std::vector<T> *acquire();
+    /**
+     * @brief Give a buffer back to the prefetcher once its batch has been processed.
+     *
+     * @param buffer The buffer returned by acquire().
+     */
+    void release(std::vector<T> *buffer);
+    /**
+     * @brief Time, in seconds, spent by the caller waiting for batches that were not ready.
+     */
+    double getStallTime() const;
+    /**
+     * @brief Number of times the caller had to wait for a batch.
+     */
+    unsigned int getNrStalls() const;
+    /**
+     * @brief Time, in seconds, spent by the I/O thread waiting for a free buffer.
+     */
+    double getIdleTime() const;
+
+  private:
+    void prefetch();
+
+    std::function<bool(std::vector<T> *)> source;
+    std::vector<std::vector<T>> buffers;
+    std::deque<std::vector<T> *> freeBuffers;
+    std::deque<std::vector<T> *> readyBuffers;
+    bool endOfData;
+    bool stop;
+    std::exception_ptr error;
+    double stallTime;
+    unsigned int nrStalls;
+    double idleTime;
+    mutable std::mutex lock;
+    std::condition_variable freeCondition;
+    std::condition_variable readyCondition;
+    std::thread ioThread;
+};
+
+// Implementations
+
+template <typename T>
+BatchPrefetcher<T>::BatchPrefetcher(const std::function<bool(std::vector<T> *)> &source, const std::size_t bufferSize, const unsigned int nrBuffers) : source(source), buffers(nrBuffers, std::vector<T>(bufferSize)), endOfData(false), stop(false), stallTime(0.0), nrStalls(0), idleTime(0.0)
+{
+    for (auto &buffer : buffers)
+    {
+        freeBuffers.push_back(&buffer);
+    }
+    ioThread = std::thread(&BatchPrefetcher<T>::prefetch, this);
+}
+
+template <typename T>
+BatchPrefetcher<T>::~BatchPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    freeCondition.notify_all();
+    ioThread.join();
+}
+
+template <typename T>
+std::vector<T> *BatchPrefetcher<T>::acquire()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    std::vector<T> *buffer = nullptr;
+
+    if (readyBuffers.empty() && !endOfData)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        readyCondition.wait(guard, [this] { return !readyBuffers.empty() || endOfData; });
+        stallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        nrStalls++;
+    }
+    if (readyBuffers.empty())
+    {
+        if (error)
+        {
+            std::exception_ptr sourceError = error;
+
+            error = nullptr;
+            std::rethrow_exception(sourceError);
+        }
+        return nullptr;
+    }
+    buffer = readyBuffers.front();
+    readyBuffers.pop_front();
+    return buffer;
+}
+
+template <typename T>
+void BatchPrefetcher<T>::release(std::vector<T> *buffer)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        freeBuffers.push_back(buffer);
+    }
+    freeCondition.notify_one();
+}
+
+template <typename T>
+inline double BatchPrefetcher<T>::getStallTime() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stallTime;
+}
+
+template <typename T>
+inline unsigned int BatchPrefetcher<T>::getNrStalls() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return nrStalls;
+}
+
+template <typename T>
+inline double BatchPrefetcher<T>::getIdleTime() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return idleTime;
+}
+
+template <typename T>
+void BatchPrefetcher<T>::prefetch()
+{
+    while (true)
+    {
+        std::vector<T> *buffer = nullptr;
+        bool filled = false;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            auto start = std::chrono::steady_clock::now();
+
+            freeCondition.wait(guard, [this] { return !freeBuffers.empty() || stop; });
+            idleTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (stop)
+            {
+                return;
+            }
+            buffer = freeBuffers.front();
+            freeBuffers.pop_front();
+        }
+        // The source is called without holding the lock, so that the caller can keep acquiring ready batches
+        try
+        {
+            filled = source(buffer);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (filled)
+            {
+                readyBuffers.push_back(buffer);
+            }
+            else
+            {
+                freeBuffers.push_back(buffer);
+                endOfData = true;
+            }
+        }
+        readyCondition.notify_one();
+        if (!filled)
+        {
+            return;
+        }
+    }
+}
+
+} // namespace AstroData
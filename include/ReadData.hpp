@@ -17,8 +17,22 @@
 #include <set>
 #include <string>
 #include <cstring>
+#include <cstdint>
+#include <cerrno>
 #include <cmath>
 #include <exception>
+#include <stdexcept>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif // __SSSE3__
 #ifdef HAVE_HDF5
 #include <H5Cpp.h>
 #endif // HAVE_HDF5
@@ -30,6 +44,8 @@
 #include <utils.hpp>
 #include "Observation.hpp"
 #include "Platform.hpp"
+#include "BatchArena.hpp"
+#include "Half.hpp"
 
 #pragma once
 
@@ -49,6 +65,319 @@ class RingBufferError : public std::exception
     std::string message;
 };
 
+/**
+ * @brief Parameters stored in the header of a SIGPROC filterbank file.
+ */
+struct SIGPROCHeader
+{
+    SIGPROCHeader();
+
+    // Size of the header in bytes
+    std::uint64_t headerSize;
+    std::string sourceName;
+    std::string rawDataFile;
+    int telescopeID;
+    int machineID;
+    int dataType;
+    int barycentric;
+    int pulsarcentric;
+    unsigned int nbits;
+    unsigned int nifs;
+    unsigned int nchans;
+    unsigned int nbeams;
+    unsigned int ibeam;
+    // Number of samples, computed from the size of the file when not in the header
+    unsigned int nsamples;
+    double tsamp;
+    double tstart;
+    double fch1;
+    double foff;
+    double refdm;
+    double period;
+    double srcRaj;
+    double srcDej;
+    double azStart;
+    double zaStart;
+    // Samples are signed integers
+    bool signedData;
+    // Folded data only
+    int nbins;
+    std::int64_t npuls;
+};
+
+/**
+ * @brief Parameters of one beam of a LOFAR observation.
+ */
+struct LOFARBeam
+{
+    LOFARBeam();
+
+    // Name of the beam group, e.g. BEAM_000
+    std::string name;
+    unsigned int nrSamples;
+    unsigned int nrStations;
+    unsigned int nrChannelsPerSubband;
+    // Bandwidth of a channel, in MHz
+    float channelBandwidth;
+    unsigned int nrSubbands;
+};
+
+/**
+ * @brief Metadata of a LOFAR observation, as stored in its HDF5 file.
+ */
+struct LOFARMetadata
+{
+    LOFARMetadata();
+
+    // Name of the sub-array pointing group, e.g. SUB_ARRAY_POINTING_000
+    std::string subArrayPointing;
+    double minFreq;
+    double totalIntegrationTime;
+    unsigned int nrBeams;
+    // Beam groups, sorted by name
+    std::vector<LOFARBeam> beams;
+};
+
+/**
+ * @brief Read-only memory mapping of a SIGPROC filterbank file.
+ *
+ * Batches are exposed as views straight into the mapping, in the sample-major layout of the file.
+ * The kernel is told that the file is read sequentially; readahead for upcoming batches and the
+ * release of already consumed batches can be requested explicitly.
+ */
+class SIGPROCMapping
+{
+  public:
+    /**
+     * @brief Map a SIGPROC filterbank file.
+     *
+     * @param observation Object containing the observation parameters.
+     * @param inputBits Number of bits each sample is represented with.
+     * @param bytesToSkip Number of bytes used for the header.
+     * @param inputFilename Name of the filterbank file.
+     */
+    SIGPROCMapping(const Observation &observation, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename);
+    SIGPROCMapping(const SIGPROCMapping &) = delete;
+    SIGPROCMapping &operator=(const SIGPROCMapping &) = delete;
+    ~SIGPROCMapping() noexcept;
+
+    /**
+     * @brief Number of complete batches contained in the file.
+     */
+    std::uint64_t getNrBatches() const;
+    /**
+     * @brief Size, in bytes, of one batch in the file.
+     */
+    std::uint64_t getBatchSize() const;
+    /**
+     * @brief Pointer to the first byte of a batch, in file layout.
+     *
+     * @param batch Batch to access.
+     */
+    const char *getBatchAddress(const unsigned int batch) const;
+    /**
+     * @brief Pointer to the first element of a batch, in file layout.
+     * The batch starts after a header of arbitrary size, so FileError is thrown if it is not aligned for T;
+     * getBatchAddress() gives access to any batch.
+     *
+     * @tparam T Data type of the filterbank file.
+     * @param batch Batch to access.
+     */
+    template <typename T>
+    const T *getBatch(const unsigned int batch) const;
+    /**
+     * @brief Ask the kernel to start reading some batches ahead of their use.
+     *
+     * @param batch First batch to read ahead.
+     * @param nrBatches Number of batches to read ahead.
+     */
+    void prefetch(const unsigned int batch, const unsigned int nrBatches = 1) const;
+    /**
+     * @brief Release the memory backing some batches that have already been consumed.
+     * Views to released batches stay valid, but accessing them reads the file again.
+     *
+     * @param batch First batch to release.
+     * @param nrBatches Number of batches to release.
+     */
+    void release(const unsigned int batch, const unsigned int nrBatches = 1) const;
+
+  private:
+    void advise(const std::uint64_t begin, const std::uint64_t end, const int advice) const;
+
+    std::string filename;
+    char *mapping;
+    std::uint64_t mappingSize;
+    std::uint64_t headerSize;
+    std::uint64_t batchSize;
+    std::uint64_t pageSize;
+};
+
+/**
+ * @brief How SIGPROCStream reads from the file system.
+ */
+enum class StreamMode
+{
+    // Normal reads through the page cache
+    Buffered,
+    // Normal reads, dropping the batches from the page cache once read
+    DropCache,
+    // Direct reads bypassing the page cache; DropCache is used if the file system does not support it
+    Direct
+};
+
+/**
+ * @brief Sequential reader of SIGPROC filterbank files.
+ *
+ * The file is opened and its header parsed only once, and the batch buffer is reused for the whole stream.
+ * Batches are read one after the other, without seeking, unless explicitly repositioned.
+ *
+ * @tparam T Data type of the filterbank file.
+ */
+template <typename T>
+class SIGPROCStream
+{
+  public:
+    /**
+     * @brief Open a SIGPROC filterbank file and read its header.
+     *
+     * @param observation Object to populate with read observation parameters; the number of batches must be already set.
+     * @param padding Padding used for cache aligning.
+     * @param inputBits Number of bits each sample is represented with.
+     * @param inputFilename Name of the filterbank file.
+     * @param subbands Number of subbands for processing (default is 0).
+     * @param mode How the file is read; only one batch is buffered in memory, whatever the mode.
+     */
+    SIGPROCStream(Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::string &inputFilename, const unsigned int subbands = 0, const StreamMode mode = StreamMode::Buffered);
+    SIGPROCStream(const SIGPROCStream &) = delete;
+    SIGPROCStream &operator=(const SIGPROCStream &) = delete;
+    ~SIGPROCStream();
+
+    /**
+     * @brief Read the next batch of the stream.
+     *
+     * @param data Data structure to read data into, in padded channel-major layout, of at least getPaddedBatchSize<T>(observation, padding, inputBits) items; std::out_of_range is thrown otherwise.
+     * @return False if there are no more batches to read, true otherwise.
+     */
+    bool next(std::vector<T> *data);
+    /**
+     * @brief Read the next batch of the stream, reduced while it is transposed; see reduceSIGPROC().
+     *
+     * @tparam O Data type of the reduced batch, wide enough to hold the sums.
+     * @param data Data structure to read data into, of at least getReducedBatchSize() items; std::out_of_range is thrown otherwise.
+     * @param subbands Sum the channels of every subband.
+     * @return False if there are no more batches to read, true otherwise.
+     */
+    template <typename O>
+    bool nextReduced(std::vector<O> *data, const bool subbands = false);
+    /**
+     * @brief Read the next batch of the stream, skipping zapped channels while it is transposed; see compactSIGPROC().
+     *
+     * @param data Data structure to read data into, of at least getCompactedBatchSize() items; std::out_of_range is thrown otherwise.
+     * @param channelMap The channels to keep, as returned by getChannelMap().
+     * @return False if there are no more batches to read, true otherwise.
+     */
+    bool nextCompacted(std::vector<T> *data, const std::vector<unsigned int> &channelMap);
+    /**
+     * @brief Read the next batch of the stream, converted to a different type while it is transposed; see convertSIGPROC().
+     *
+     * @tparam O Data type of the converted batch, e.g. half.
+     * @param data Data structure to read data into, of at least getPaddedBatchSize<O>(observation, padding, sizeof(O) * 8) items; std::out_of_range is thrown otherwise.
+     * @param scale Factor every sample is multiplied by.
+     * @param offset Value added to every sample after scaling.
+     * @return False if there are no more batches to read, true otherwise.
+     */
+    template <typename O>
+    bool nextConverted(std::vector<O> *data, const float scale = 1.0f, const float offset = 0.0f);
+    /**
+     * @brief Move the stream to a different batch.
+     *
+     * @param batch The batch that will be read by the next call of next().
+     */
+    void seek(const unsigned int batch);
+    /**
+     * @brief Index of the batch that will be read by the next call of next().
+     */
+    unsigned int getBatch() const;
+    /**
+     * @brief Size, in bytes, of the header of the file.
+     */
+    std::uint64_t getHeaderSize() const;
+    /**
+     * @brief Content of the header of the file.
+     */
+    const SIGPROCHeader &getHeader() const;
+    /**
+     * @brief Observation parameters of the stream.
+     */
+    const Observation &getObservation() const;
+    /**
+     * @brief Mode used to read the file, which can differ from the requested one.
+     */
+    StreamMode getMode() const;
+
+  private:
+    // Block size for direct I/O alignment
+    static constexpr std::uint64_t directAlignment = 4096;
+
+    const uint8_t *readBatch();
+
+    Observation observation;
+    unsigned int padding;
+    uint8_t inputBits;
+    StreamMode mode;
+    int inputFile;
+    SIGPROCHeader header;
+    unsigned int batch;
+    std::uint64_t batchSize;
+    BatchArena<uint8_t> batchBuffer;
+};
+
+#ifdef HAVE_PSRDADA
+/**
+ * @brief Read-only view of the next full block of a PSRDADA ring buffer.
+ *
+ * The block is borrowed straight from the shared memory of the ring buffer, without copying it,
+ * and marked as cleared when the view is released or destroyed; until then, the writer cannot reuse it.
+ * Only one block can be borrowed at a time from a ring buffer.
+ *
+ * @tparam T Data type of the block.
+ */
+template <typename T>
+class PSRDADABlock
+{
+  public:
+    /**
+     * @brief Wait for the next full block and borrow it.
+     *
+     * @param ringBuffer The PSRDADA ring buffer.
+     */
+    explicit PSRDADABlock(dada_hdu_t &ringBuffer);
+    PSRDADABlock(const PSRDADABlock &) = delete;
+    PSRDADABlock &operator=(const PSRDADABlock &) = delete;
+    PSRDADABlock(PSRDADABlock &&other) noexcept;
+    ~PSRDADABlock();
+
+    /**
+     * @brief The content of the block.
+     */
+    const T *data() const;
+    /**
+     * @brief Number of elements in the block.
+     */
+    std::size_t size() const;
+    /**
+     * @brief Give the block back to the ring buffer.
+     * The view cannot be used afterwards.
+     */
+    void release();
+
+  private:
+    ipcbuf_t *dataBlock;
+    const T *buffer;
+    uint64_t bufferBytes;
+};
+
+#endif // HAVE_PSRDADA
 /**
  ** @brief Read the list of channels excluded from the computation.
  **
@@ -57,6 +386,14 @@ class RingBufferError : public std::exception
  ** @param zappedChannels The vector in which to store the index of the zapped channels.
  */
 void readZappedChannels(Observation &observation, const std::string &inputFileName, std::vector<unsigned int> &zappedChannels);
+/**
+ * @brief Map the channels of a compacted batch, i.e. one without zapped channels, to the channels of the observation.
+ *
+ * @param observation Object containing the observation parameters.
+ * @param zappedChannels The zapped channels, as populated by readZappedChannels().
+ * @return For every channel of a compacted batch, in order, the index of the corresponding channel of the observation.
+ */
+std::vector<unsigned int> getChannelMap(const Observation &observation, const std::vector<unsigned int> &zappedChannels);
 /**
  ** @brief Read the list of integration steps.
  ** Each integration step is a value representing a width in samples.
@@ -75,12 +412,59 @@ std::uint64_t getSIGPROCHeaderSize(const std::string &inputFilename);
 /**
  * @brief Read the header of the filterbank file.
  * 
- * @param headerSize The size of the header in bytes.
+ * @param headerSize The size of the header in bytes; unused, the header is self-delimiting.
  * @param observation Object to populate with read observation parameters.
  * @param inputFilename Name of the filterbank file.
  * @param subbands Number of subbands for processing (default is 0).
  */
 void readSIGPROCHeader(const std::uint64_t headerSize, Observation & observation, const std::string & inputFilename, const unsigned int subbands = 0);
+/**
+ * @brief Parse the header of a SIGPROC filterbank file.
+ * The header is read in a single buffered pass.
+ *
+ * @param inputFilename Name of the filterbank file.
+ * @return The content of the header.
+ */
+SIGPROCHeader readSIGPROCHeader(const std::string &inputFilename);
+/**
+ * @brief Parse the header of an open SIGPROC filterbank file.
+ * The header is read in a single buffered pass, and the file is left positioned at the first sample.
+ * Unknown keywords cannot be sized, so the rest of the header is skipped up to HEADER_END.
+ *
+ * @param inputFile The filterbank file.
+ * @return The content of the header.
+ */
+SIGPROCHeader readSIGPROCHeader(std::istream &inputFile);
+/**
+ * @brief Parse the header of a SIGPROC filterbank file, or return it from the cache if already parsed.
+ * The file is parsed again if it has been replaced, resized or modified since it was cached.
+ *
+ * @param inputFilename Name of the filterbank file.
+ * @return The content of the header.
+ */
+SIGPROCHeader getSIGPROCHeader(const std::string &inputFilename);
+/**
+ * @brief Remove all parsed headers from the cache.
+ */
+void clearSIGPROCHeaderCache();
+/**
+ * @brief Populate the observation parameters from the header of a SIGPROC file.
+ *
+ * @param header The content of the header.
+ * @param observation Object to populate with read observation parameters; the number of batches must be already set.
+ * @param subbands Number of subbands for processing (default is 0).
+ */
+void setSIGPROCObservation(const SIGPROCHeader &header, Observation & observation, const unsigned int subbands = 0);
+/**
+ * @brief Size, in bytes, of one batch of a SIGPROC filterbank file.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param inputBits Number of bits each sample is represented with.
+ * @return The size of one batch.
+ */
+template <typename T>
+inline std::uint64_t getSIGPROCBatchSize(const Observation &observation, const uint8_t inputBits);
 /**
  * @brief Read a full SIGPROC filterbank file.
  * @tparam T Data type of the filterbank file.
@@ -90,44 +474,542 @@ void readSIGPROCHeader(const std::uint64_t headerSize, Observation & observation
  * @param bytesToSkip Number of bytes used for the header.
  * @param inputFilename Name of the filterbank file
  * @param data Data structure to read data into.
- * @param firstBatch First batch to read.
+ * @param firstBatch First batch to read, counting from zero.
  */
 template <typename T>
 void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<std::vector<T> *> &data, const unsigned int firstBatch = 0);
 /**
- * @brief Read one batch from a SIGPROC filterbank file.
+ * @brief Read a full SIGPROC filterbank file into a batch arena.
+ * The arena is resized to contain all batches, reusing its memory when possible.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data Arena to read data into.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, BatchArena<T> &data, const unsigned int firstBatch = 0);
+/**
+ * @brief Read a full SIGPROC filterbank file into preallocated batches.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data One pointer per batch, each to memory large enough for a padded batch.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<T *> &data, const unsigned int firstBatch = 0);
+/**
+ * @brief Read a full SIGPROC filterbank file using multiple threads.
+ * Each thread reads its own batches, or ranges of samples of a batch when there are fewer batches than threads,
+ * with positioned reads, and transposes them; the result is the same as the one of the serial reader.
+ * Nothing is read if the observation has no batches.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data One pointer per batch, each to memory large enough for a padded batch.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T>
+void readSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<T *> &data, const unsigned int nrThreads = 0, const unsigned int firstBatch = 0);
+/**
+ * @brief Read a full SIGPROC filterbank file into a batch arena using multiple threads.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data Arena to read data into.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T>
+void readSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, BatchArena<T> &data, const unsigned int nrThreads = 0, const unsigned int firstBatch = 0);
+/**
+ * @brief Read a number of bytes from a given offset of a file, without moving the file position.
+ *
+ * @param fileDescriptor The open file.
+ * @param buffer Memory to read into.
+ * @param size Number of bytes to read.
+ * @param offset Offset, in bytes, from the beginning of the file.
+ */
+void readFileAt(const int fileDescriptor, void *buffer, const std::uint64_t size, const std::uint64_t offset);
+/**
+ * @brief Number of elements of one batch in the padded channel-major layout.
  *
  * @tparam T Data type of the filterbank file.
  * @param observation Object containing the observation parameters.
  * @param padding Padding used for cache aligning.
  * @param inputBits Number of bits each sample is represented with.
+ * @return The number of elements, including padding.
+ */
+template <typename T>
+inline std::uint64_t getPaddedBatchSize(const Observation &observation, const unsigned int padding, const uint8_t inputBits);
+/**
+ * @brief Read one batch from a SIGPROC filterbank file.
+ * The rows of the batch are not padded, whatever the padding: each channel contains getNrSamplesPerBatch() samples,
+ * packed when inputBits is smaller than 8; use readSIGPROCBatch() for the padded layout.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning, not used.
+ * @param inputBits Number of bits each sample is represented with.
  * @param bytesToSkip Number of bytes used for the header.
  * @param inputFilename Name of the filterbank file.
- * @param data Data structure to read data into.
+ * @param data Data structure to read data into, large enough for the unpadded batch; std::out_of_range is thrown otherwise.
  * @param batch Batch to read.
  */
 template <typename T>
 void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<T> *data, const unsigned int batch = 0);
-#ifdef HAVE_HDF5
-// LOFAR data
+/**
+ * @brief Read one batch from a SIGPROC filterbank file, in the padded channel-major layout.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file.
+ * @param data Data structure to read data into, of at least getPaddedBatchSize<T>(observation, padding, inputBits) items; std::out_of_range is thrown otherwise.
+ * @param batch Batch to read.
+ */
 template <typename T>
-void readLOFAR(std::string headerFilename, std::string rawFilename, Observation &observation, const unsigned int padding, std::vector<std::vector<T> *> &data, unsigned int nrBatches = 0, unsigned int firstBatch = 0);
-#endif // HAVE_HDF5
-#ifdef HAVE_PSRDADA
-// PSRDADA buffer
-void readPSRDADAHeader(Observation &observation, dada_hdu_t &ringBuffer);
+void readSIGPROCBatch(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<T> *data, const unsigned int batch = 0);
+/**
+ * @brief Read one batch from a memory mapped SIGPROC filterbank file, in the padded channel-major layout.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param inputFile The mapped filterbank file.
+ * @param data Data structure to read data into, of at least getPaddedBatchSize<T>(observation, padding, inputBits) items; std::out_of_range is thrown otherwise.
+ * @param batch Batch to read.
+ */
 template <typename T>
-inline void readPSRDADA(dada_hdu_t &ringBuffer, std::vector<T> *data);
-#endif // HAVE_PSRDADA
-
-// Implementations
-
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const SIGPROCMapping &inputFile, std::vector<T> *data, const unsigned int batch = 0);
+/**
+ * @brief Transpose one batch from the sample-major SIGPROC layout to the channel-major layout.
+ * The order of channels is reversed, so that the first channel is the one with the lowest frequency.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param input The samples to transpose, in SIGPROC layout.
+ * @param output The batch in channel-major layout.
+ * @param firstSample First sample of the batch to transpose; for packed samples, a multiple of the number of items per byte.
+ * @param nrSamples Number of samples to transpose, zero for all the samples from firstSample to the end of the batch.
+ */
 template <typename T>
-void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<std::vector<T> *> &data, const unsigned int firstBatch)
+void transposeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, T *output, const unsigned int firstSample = 0, unsigned int nrSamples = 0);
+/**
+ * @brief Number of items of a padded batch reduced by reduceSIGPROC().
+ *
+ * @tparam O Data type of the reduced batch.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param subbands Channels are summed in subbands.
+ */
+template <typename O>
+inline std::uint64_t getReducedBatchSize(const Observation &observation, const unsigned int padding, const bool subbands);
+/**
+ * @brief Transpose one batch from the SIGPROC layout to the padded channel-major layout, reducing it in the same pass.
+ * Samples are summed in groups of the observation's downsampling factor and, optionally, the channels of every subband are
+ * summed together; samples left over at the end of the batch are discarded.
+ * The reduced batch contains getNrSubbands(), or getNrChannels(), rows of getNrSamplesPerBatch() / getDownsampling() samples.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @tparam O Data type of the reduced batch, wide enough to hold the sums.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param input The samples to reduce, in SIGPROC layout.
+ * @param output The reduced batch in channel-major layout.
+ * @param subbands Sum the channels of every subband.
+ */
+template <typename T, typename O>
+void reduceSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, O *output, const bool subbands);
+/**
+ * @brief Read a full SIGPROC filterbank file, reducing every batch while it is transposed; see reduceSIGPROC().
+ *
+ * @tparam T Data type of the filterbank file.
+ * @tparam O Data type of the reduced batches, wide enough to hold the sums.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data One pointer per batch, each to memory large enough for getReducedBatchSize() items.
+ * @param subbands Sum the channels of every subband.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T, typename O>
+void readReducedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<O *> &data, const bool subbands = false, const unsigned int firstBatch = 0);
+/**
+ * @brief Read one batch from a SIGPROC filterbank file, reducing it while it is transposed; see reduceSIGPROC().
+ *
+ * @tparam T Data type of the filterbank file.
+ * @tparam O Data type of the reduced batch, wide enough to hold the sums.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file.
+ * @param data Data structure to read data into, of at least getReducedBatchSize() items; std::out_of_range is thrown otherwise.
+ * @param subbands Sum the channels of every subband.
+ * @param batch Batch to read.
+ */
+template <typename T, typename O>
+void readReducedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<O> *data, const bool subbands = false, const unsigned int batch = 0);
+/**
+ * @brief Read a full SIGPROC filterbank file using multiple threads, reducing every batch while it is transposed; see reduceSIGPROC().
+ * The batches are distributed over the threads, as a reduced batch cannot be split in independent ranges of samples.
+ * Nothing is read if the observation has no batches.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @tparam O Data type of the reduced batches, wide enough to hold the sums.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param bytesToSkip Number of bytes used for the header.
+ * @param inputFilename Name of the filterbank file
+ * @param data One pointer per batch, each to memory large enough for getReducedBatchSize() items.
+ * @param subbands Sum the channels of every subband.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ * @param firstBatch First batch to read, counting from zero.
+ */
+template <typename T, typename O>
+void readReducedSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<O *> &data, const bool subbands = false, const unsigned int nrThreads = 0, const unsigned int firstBatch = 0);
+/**
+ * @brief Number of items of a padded batch compacted by compactSIGPROC().
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param channelMap The channels to keep.
+ */
+template <typename T>
+inline std::uint64_t getCompactedBatchSize(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::vector<unsigned int> &channelMap);
+/**
+ * @brief Transpose one batch from the SIGPROC layout to the padded channel-major layout, keeping only some channels.
+ * Row i of the compacted batch contains channel channelMap[i] of the observation; zapped channels are never read or stored.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param input The samples to transpose, in SIGPROC layout.
+ * @param output The compacted batch in channel-major layout.
+ * @param channelMap The channels to keep, as returned by getChannelMap(); FileError is thrown if a channel is not part of the observation.
+ */
+template <typename T>
+void compactSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, T *output, const std::vector<unsigned int> &channelMap);
+/**
+ * @brief Convert single precision values to another type; values are truncated when converted to integers.
+ *
+ * @tparam O Data type of the converted values.
+ * @param input The single precision values.
+ * @param output The converted values.
+ * @param nrItems Number of values to convert.
+ */
+template <typename O>
+inline void convertFloats(const float *input, O *output, const uint64_t nrItems);
+inline void convertFloats(const float *input, half *output, const uint64_t nrItems);
+/**
+ * @brief Transpose one batch from the SIGPROC layout to the padded channel-major layout, converting it to a different type.
+ * Every sample is converted to single precision, scaled and offset, and then converted to the output type, so that
+ * e.g. single precision files are stored in half precision, or 8 bits files in single precision.
+ * The converted batch is padded for the output type, and contains getPaddedBatchSize<O>(observation, padding, sizeof(O) * 8) items.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @tparam O Data type of the converted batch.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param input The samples to convert, in SIGPROC layout.
+ * @param output The converted batch in channel-major layout.
+ * @param scale Factor every sample is multiplied by.
+ * @param offset Value added to every sample after scaling.
+ */
+template <typename T, typename O>
+void convertSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, O *output, const float scale = 1.0f, const float offset = 0.0f);
+/**
+ * @brief Transpose samples of at least 8 bits from sample-major to padded channel-major layout, in cache tiles.
+ *
+ * @tparam T Data type of the samples.
+ * @param input The samples, each one containing all channels.
+ * @param output The first sample of the channel-major output.
+ * @param nrChannels Number of channels.
+ * @param nrSamples Number of samples to transpose.
+ * @param nrPaddedSamples Number of samples of an output channel, including padding.
+ * @param reverseChannels Reverse the order of channels, as required by SIGPROC files.
+ * @param sampleStride Number of input elements between consecutive samples, zero if equal to the number of channels.
+ */
+template <typename T>
+void transposeSampleMajor(const T *input, T *output, const unsigned int nrChannels, const unsigned int nrSamples, const uint64_t nrPaddedSamples, const bool reverseChannels, uint64_t sampleStride = 0);
+/**
+ * @brief Order of the items in a block containing multiple beams.
+ */
+enum class BlockLayout
 {
-    std::ifstream inputFile;
-    const unsigned int BUFFER_DIM = sizeof(T);
-    char *buffer = nullptr;
+    // [sample][beam][channel]
+    TimeMajor,
+    // [beam][sample][channel]
+    BeamMajor
+};
+/**
+ * @brief Transpose a block containing all beams of a batch into padded channel-major batches, one per beam, in a single pass.
+ * Beams and ranges of samples are distributed over multiple threads.
+ *
+ * @tparam T Data type of the samples, at least 8 bits wide.
+ * @param observation Object containing the observation parameters, including the number of beams.
+ * @param padding Padding used for cache aligning.
+ * @param layout Order of the items in the block.
+ * @param input The block.
+ * @param output One pointer per beam, each to memory large enough for a padded batch.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ */
+template <typename T>
+void transposeBlock(const Observation &observation, const unsigned int padding, const BlockLayout layout, const T *input, const std::vector<T *> &output, const unsigned int nrThreads = 0);
+/**
+ * @brief Transpose one batch of packed 1, 2 or 4 bits samples from the SIGPROC layout to the channel-major layout.
+ * The number of channels, firstSample and nrSamples must be multiples of the number of items per byte.
+ *
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param inputBits Number of bits each sample is represented with.
+ * @param input The samples to transpose, in SIGPROC layout.
+ * @param output The batch in channel-major layout.
+ * @param firstSample First sample of the batch to transpose.
+ * @param nrSamples Number of samples to transpose.
+ */
+inline void transposePackedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const uint8_t *input, uint8_t *output, const unsigned int firstSample, const unsigned int nrSamples);
+/**
+ * @brief Transpose the square matrices of packed items contained in a 64 bits word.
+ * Each byte is a row of a matrix, and each matrix has as many rows as items in a byte.
+ *
+ * @param word The matrices to transpose.
+ * @param inputBits Number of bits each item is represented with.
+ * @return The transposed matrices.
+ */
+inline uint64_t transposePackedMatrices(uint64_t word, const uint8_t inputBits);
+#ifdef HAVE_HDF5
+// LOFAR data
+template <typename T>
+void readLOFAR(std::string headerFilename, std::string rawFilename, Observation &observation, const unsigned int padding, std::vector<std::vector<T> *> &data, unsigned int nrBatches = 0, unsigned int firstBatch = 0);
+template <typename T>
+void readLOFAR(std::string headerFilename, std::string rawFilename, Observation &observation, const unsigned int padding, BatchArena<T> &data, unsigned int nrBatches = 0, unsigned int firstBatch = 0);
+/**
+ * @brief Read all beams of a LOFAR observation concurrently, using the cached metadata.
+ * The raw files are checked against the metadata with checkLOFARBeams() before reading.
+ *
+ * @tparam T Data type of the samples, 32 bits wide.
+ * @param headerFilename Name of the HDF5 file.
+ * @param rawFilenames For each beam, the names of its raw files in channel order.
+ * @param observation Object to populate with the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param data The batches of each beam.
+ * @param nrBatches Number of batches to read, zero for all.
+ * @param firstBatch First batch to read.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ */
+template <typename T>
+void readLOFAR(const std::string &headerFilename, const std::vector<std::vector<std::string>> &rawFilenames, Observation &observation, const unsigned int padding, std::vector<BatchArena<T>> &data, unsigned int nrBatches = 0, unsigned int firstBatch = 0, const unsigned int nrThreads = 0);
+void readLOFARHeader(const std::string &headerFilename, Observation &observation, unsigned int nrBatches, unsigned int firstBatch);
+/**
+ * @brief Parse the HDF5 metadata of a LOFAR observation.
+ * The sub-array pointing and its beams are found by name.
+ *
+ * @param headerFilename Name of the HDF5 file.
+ * @return The metadata.
+ */
+LOFARMetadata readLOFARMetadata(const std::string &headerFilename);
+/**
+ * @brief Parse the HDF5 metadata of a LOFAR observation, or return it from the cache if already parsed.
+ *
+ * @param headerFilename Name of the HDF5 file.
+ * @return The metadata.
+ */
+LOFARMetadata getLOFARMetadata(const std::string &headerFilename);
+/**
+ * @brief Remove all parsed metadata from the cache.
+ */
+void clearLOFARMetadataCache();
+#endif // HAVE_HDF5
+/**
+ * @brief Populate the observation parameters from the metadata of a LOFAR observation.
+ *
+ * @param metadata The metadata.
+ * @param observation Object to populate with the observation parameters.
+ * @param nrBatches Number of batches to read, zero for all.
+ * @param firstBatch First batch to read.
+ * @param beam Beam whose parameters are used.
+ */
+void setLOFARObservation(const LOFARMetadata &metadata, Observation &observation, const unsigned int nrBatches = 0, const unsigned int firstBatch = 0, const unsigned int beam = 0);
+/**
+ * @brief Check that the raw files match the beams of a LOFAR observation, and that all beams share the parameters of the first one.
+ * FileError is thrown otherwise.
+ *
+ * @param metadata The metadata.
+ * @param rawFilenames For each beam, the names of its raw files in channel order.
+ */
+void checkLOFARBeams(const LOFARMetadata &metadata, const std::vector<std::vector<std::string>> &rawFilenames);
+/**
+ * @brief Read the raw files of multiple LOFAR beams concurrently, one batch arena per beam.
+ * The data of a beam can be split in multiple raw files, each containing an equal and consecutive part of the channels.
+ *
+ * @tparam T Data type of the samples, 32 bits wide.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param rawFilenames For each beam, the names of its raw files in channel order.
+ * @param data The batches of each beam.
+ * @param firstBatch First batch to read.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ */
+template <typename T>
+void readLOFARBeams(const Observation &observation, const unsigned int padding, const std::vector<std::vector<std::string>> &rawFilenames, std::vector<BatchArena<T>> &data, const unsigned int firstBatch = 0, const unsigned int nrThreads = 0);
+/**
+ * @brief Read the batches of a LOFAR raw file, containing big endian 32 bits samples of all channels.
+ * The file is read in blocks of samples, which are byte swapped and transposed in cache tiles.
+ *
+ * @tparam T Data type of the samples, 32 bits wide.
+ * @param rawFilename Name of the raw file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param data One pointer per batch, each to memory large enough for a padded batch.
+ * @param firstBatch First batch to read.
+ * @param firstChannel First channel contained in the file, when the channels are split over multiple files.
+ * @param nrFileChannels Number of channels contained in the file, zero for all channels.
+ */
+template <typename T>
+void readLOFARRaw(const std::string &rawFilename, const Observation &observation, const unsigned int padding, const std::vector<T *> &data, unsigned int firstBatch, const unsigned int firstChannel = 0, unsigned int nrFileChannels = 0);
+/**
+ * @brief Convert an array of 32 bits words from big endian to little endian, in place.
+ *
+ * @param data The words.
+ * @param nrWords Number of words.
+ */
+inline void swapBytes32(void *data, const uint64_t nrWords);
+#ifdef HAVE_PSRDADA
+// PSRDADA buffer
+void readPSRDADAHeader(Observation &observation, dada_hdu_t &ringBuffer);
+/**
+ * @brief Copy the next block of a PSRDADA ring buffer; use PSRDADABlock to access the block without copying it.
+ *
+ * @tparam T Data type of the block.
+ * @param ringBuffer The PSRDADA ring buffer.
+ * @param data Data structure to copy the block into.
+ */
+template <typename T>
+inline void readPSRDADA(dada_hdu_t &ringBuffer, std::vector<T> *data);
+/**
+ * @brief Read the next block of a PSRDADA ring buffer, containing all beams of a batch, into padded channel-major batches.
+ * The block is transposed straight from the ring buffer, without an intermediate copy.
+ *
+ * @tparam T Data type of the block.
+ * @param ringBuffer The PSRDADA ring buffer.
+ * @param observation Object containing the observation parameters, including the number of beams.
+ * @param padding Padding used for cache aligning.
+ * @param layout Order of the items in the block.
+ * @param data One pointer per beam, each to memory large enough for a padded batch.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ */
+template <typename T>
+void readPSRDADA(dada_hdu_t &ringBuffer, const Observation &observation, const unsigned int padding, const BlockLayout layout, const std::vector<T *> &data, const unsigned int nrThreads = 0);
+#endif // HAVE_PSRDADA
+
+// Implementations
+
+template <typename T>
+inline std::uint64_t getSIGPROCBatchSize(const Observation &observation, const uint8_t inputBits)
+{
+    if (inputBits >= 8)
+    {
+        return static_cast<std::uint64_t>(observation.getNrChannels()) * observation.getNrSamplesPerBatch() * sizeof(T);
+    }
+    return static_cast<std::uint64_t>(observation.getNrChannels()) * observation.getNrSamplesPerBatch() / (8 / inputBits);
+}
+
+template <typename T>
+inline std::uint64_t getPaddedBatchSize(const Observation &observation, const unsigned int padding, const uint8_t inputBits)
+{
+    if (inputBits >= 8)
+    {
+        return static_cast<std::uint64_t>(observation.getNrChannels()) * observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+    }
+    return static_cast<std::uint64_t>(observation.getNrChannels()) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T));
+}
+
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<std::vector<T> *> &data, const unsigned int firstBatch)
+{
+    std::vector<T *> batches(observation.getNrBatches());
+
+    for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
+    {
+        data.at(batch) = new std::vector<T>(getPaddedBatchSize<T>(observation, padding, inputBits));
+        batches.at(batch) = data.at(batch)->data();
+    }
+    readSIGPROC(observation, padding, inputBits, bytesToSkip, inputFilename, batches, firstBatch);
+}
+
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, BatchArena<T> &data, const unsigned int firstBatch)
+{
+    data.reset(observation.getNrBatches(), getPaddedBatchSize<T>(observation, padding, inputBits), padding);
+    readSIGPROC(observation, padding, inputBits, bytesToSkip, inputFilename, data.getSlots(), firstBatch);
+}
+
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<T *> &data, const unsigned int firstBatch)
+{
+    std::ifstream inputFile;
+    std::vector<T> batchBuffer(getSIGPROCBatchSize<T>(observation, inputBits) / sizeof(T));
+
+    inputFile.open(inputFilename.c_str(), std::ios::binary);
+    if (!inputFile)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    inputFile.exceptions(std::ifstream::failbit);
+    inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(firstBatch) * getSIGPROCBatchSize<T>(observation, inputBits)), std::ios::beg);
+    for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
+    {
+        inputFile.read(reinterpret_cast<char *>(batchBuffer.data()), batchBuffer.size() * sizeof(T));
+        transposeSIGPROC(observation, padding, inputBits, batchBuffer.data(), data.at(batch));
+    }
+    inputFile.close();
+}
+
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<T> *data, const unsigned int batch)
+{
+    // A padding of one item leaves the rows of the batch unpadded
+    readSIGPROCBatch(observation, sizeof(T), inputBits, bytesToSkip, inputFilename, data, batch);
+}
+
+template <typename T>
+void readSIGPROCBatch(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<T> *data, const unsigned int batch)
+{
+    std::ifstream inputFile;
+    std::vector<T> batchBuffer(getSIGPROCBatchSize<T>(observation, inputBits) / sizeof(T));
 
     inputFile.open(inputFilename.c_str(), std::ios::binary);
     inputFile.exceptions(std::ifstream::failbit);
@@ -135,286 +1017,1041 @@ void readSIGPROC(const Observation &observation, const unsigned int padding, con
     {
         throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
     }
-    if (firstBatch > 0)
+    if (data->size() < getPaddedBatchSize<T>(observation, padding, inputBits))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a batch.");
+    }
+    inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(batch) * getSIGPROCBatchSize<T>(observation, inputBits)), std::ios::beg);
+    inputFile.read(reinterpret_cast<char *>(batchBuffer.data()), batchBuffer.size() * sizeof(T));
+    transposeSIGPROC(observation, padding, inputBits, batchBuffer.data(), data->data());
+    inputFile.close();
+}
+
+template <typename T>
+inline const T *SIGPROCMapping::getBatch(const unsigned int batch) const
+{
+    const char *address = getBatchAddress(batch);
+
+    if (reinterpret_cast<std::uintptr_t>(address) % alignof(T) != 0)
+    {
+        throw FileError("ERROR: batch " + std::to_string(batch) + " of SIGPROC file \"" + filename + "\" is not aligned for its data type.");
+    }
+    return reinterpret_cast<const T *>(address);
+}
+
+template <typename T>
+void readSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<T *> &data, unsigned int nrThreads, const unsigned int firstBatch)
+{
+    const uint64_t batchSize = getSIGPROCBatchSize<T>(observation, inputBits);
+    const uint64_t sampleGranularity = (inputBits >= 8) ? std::max(64 / sizeof(T), static_cast<std::size_t>(1)) : 64 * (8 / inputBits);
+    uint64_t firstOffset = bytesToSkip;
+    uint64_t nrChunkSamples = observation.getNrSamplesPerBatch();
+    uint64_t nrChunksPerBatch = 1;
+    int inputFile = open(inputFilename.c_str(), O_RDONLY);
+
+    if (inputFile < 0)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    if (observation.getNrBatches() == 0)
+    {
+        close(inputFile);
+        return;
+    }
+    if (nrThreads == 0)
+    {
+        nrThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    firstOffset += static_cast<uint64_t>(firstBatch) * batchSize;
+    // With fewer batches than threads, batches are split in ranges of samples that do not share output cache lines
+    if (observation.getNrBatches() < nrThreads)
+    {
+        nrChunksPerBatch = (nrThreads + observation.getNrBatches() - 1) / observation.getNrBatches();
+        nrChunkSamples = isa::utils::pad((observation.getNrSamplesPerBatch() + nrChunksPerBatch - 1) / nrChunksPerBatch, sampleGranularity);
+        nrChunksPerBatch = (observation.getNrSamplesPerBatch() + nrChunkSamples - 1) / nrChunkSamples;
+    }
+    const uint64_t nrChunks = observation.getNrBatches() * nrChunksPerBatch;
+    const unsigned int nrWorkers = std::min(static_cast<uint64_t>(nrThreads), nrChunks);
+    try
+    {
+        // Chunks are distributed round-robin, so that each worker reuses the same buffer
+        parallelFor(nrWorkers, nrWorkers, [&](const uint64_t worker) {
+            std::vector<T> buffer(((batchSize * nrChunkSamples) / observation.getNrSamplesPerBatch() / sizeof(T)) + 1);
+
+            for (uint64_t chunk = worker; chunk < nrChunks; chunk += nrWorkers)
+            {
+                const unsigned int batch = chunk / nrChunksPerBatch;
+                const unsigned int firstSample = (chunk % nrChunksPerBatch) * nrChunkSamples;
+                const unsigned int nrSamples = std::min(nrChunkSamples, static_cast<uint64_t>(observation.getNrSamplesPerBatch() - firstSample));
+                uint64_t firstByte = 0;
+                uint64_t nrBytes = 0;
+
+                if (inputBits >= 8)
+                {
+                    firstByte = static_cast<uint64_t>(firstSample) * observation.getNrChannels() * sizeof(T);
+                    nrBytes = static_cast<uint64_t>(nrSamples) * observation.getNrChannels() * sizeof(T);
+                }
+                else
+                {
+                    firstByte = static_cast<uint64_t>(firstSample) * observation.getNrChannels() / (8 / inputBits);
+                    nrBytes = ((static_cast<uint64_t>(firstSample + nrSamples) * observation.getNrChannels()) / (8 / inputBits)) - firstByte;
+                }
+                readFileAt(inputFile, buffer.data(), nrBytes, firstOffset + (static_cast<uint64_t>(batch) * batchSize) + firstByte);
+                transposeSIGPROC(observation, padding, inputBits, buffer.data(), data.at(batch), firstSample, nrSamples);
+            }
+        });
+    }
+    catch (...)
+    {
+        close(inputFile);
+        throw;
+    }
+    close(inputFile);
+}
+
+template <typename T>
+void readSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, BatchArena<T> &data, const unsigned int nrThreads, const unsigned int firstBatch)
+{
+    data.reset(observation.getNrBatches(), getPaddedBatchSize<T>(observation, padding, inputBits), padding);
+    readSIGPROCParallel(observation, padding, inputBits, bytesToSkip, inputFilename, data.getSlots(), nrThreads, firstBatch);
+}
+
+template <typename T>
+void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const SIGPROCMapping &inputFile, std::vector<T> *data, const unsigned int batch)
+{
+    if (data->size() < getPaddedBatchSize<T>(observation, padding, inputBits))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a padded batch.");
+    }
+    const char *address = inputFile.getBatchAddress(batch);
+
+    if (reinterpret_cast<std::uintptr_t>(address) % alignof(T) == 0)
+    {
+        transposeSIGPROC(observation, padding, inputBits, reinterpret_cast<const T *>(address), data->data());
+    }
+    else
+    {
+        // The header shifts the batch off the alignment of T, stage it in aligned memory
+        std::vector<T> batchBuffer((inputFile.getBatchSize() + sizeof(T) - 1) / sizeof(T));
+
+        std::memcpy(batchBuffer.data(), address, inputFile.getBatchSize());
+        transposeSIGPROC(observation, padding, inputBits, batchBuffer.data(), data->data());
+    }
+}
+
+template <typename T>
+void transposeSampleMajor(const T *input, T *output, const unsigned int nrChannels, const unsigned int nrSamples, const uint64_t nrPaddedSamples, const bool reverseChannels, uint64_t sampleStride)
+{
+    // Tiles are staged in a local buffer, and each tile row fills one cache line of the output
+    constexpr unsigned int tileSamples = std::max(64 / sizeof(T), static_cast<std::size_t>(1));
+    constexpr unsigned int tileChannels = 16;
+    T tile[tileSamples][tileChannels];
+
+    if (sampleStride == 0)
+    {
+        sampleStride = nrChannels;
+    }
+    for (unsigned int sampleTile = 0; sampleTile < nrSamples; sampleTile += tileSamples)
+    {
+        for (unsigned int channelTile = 0; channelTile < nrChannels; channelTile += tileChannels)
+        {
+            if ((sampleTile + tileSamples <= nrSamples) && (channelTile + tileChannels <= nrChannels))
+            {
+                for (unsigned int sample = 0; sample < tileSamples; sample++)
+                {
+                    std::memcpy(tile[sample], input + (static_cast<uint64_t>(sampleTile + sample) * sampleStride) + channelTile, tileChannels * sizeof(T));
+                }
+                for (unsigned int channel = 0; channel < tileChannels; channel++)
+                {
+                    T *outputItem = output + (static_cast<uint64_t>(reverseChannels ? (nrChannels - 1 - (channelTile + channel)) : (channelTile + channel)) * nrPaddedSamples) + sampleTile;
+
+                    for (unsigned int sample = 0; sample < tileSamples; sample++)
+                    {
+                        outputItem[sample] = tile[sample][channel];
+                    }
+                }
+            }
+            else
+            {
+                // Partial tiles at the edges of the batch
+                for (unsigned int channel = channelTile; channel < std::min(channelTile + tileChannels, nrChannels); channel++)
+                {
+                    const T *inputItem = input + (static_cast<uint64_t>(sampleTile) * sampleStride) + channel;
+                    T *outputItem = output + (static_cast<uint64_t>(reverseChannels ? (nrChannels - 1 - channel) : channel) * nrPaddedSamples) + sampleTile;
+
+                    for (unsigned int sample = 0; sample < std::min(tileSamples, nrSamples - sampleTile); sample++)
+                    {
+                        outputItem[sample] = inputItem[static_cast<uint64_t>(sample) * sampleStride];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void transposeBlock(const Observation &observation, const unsigned int padding, const BlockLayout layout, const T *input, const std::vector<T *> &output, const unsigned int nrThreads)
+{
+    // Ranges of samples fill whole cache lines of the output, so that threads never share them
+    const unsigned int nrRangeSamples = std::max(static_cast<unsigned int>(4096 / sizeof(T)), 1u);
+    const unsigned int nrRanges = (observation.getNrSamplesPerBatch() + nrRangeSamples - 1) / nrRangeSamples;
+    const uint64_t nrChannels = observation.getNrChannels();
+    const uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+
+    parallelFor(nrThreads, static_cast<uint64_t>(observation.getNrBeams()) * nrRanges, [&](const uint64_t item) {
+        const unsigned int beam = item / nrRanges;
+        const unsigned int firstSample = (item % nrRanges) * nrRangeSamples;
+        const unsigned int nrSamples = std::min(nrRangeSamples, observation.getNrSamplesPerBatch() - firstSample);
+
+        if (layout == BlockLayout::TimeMajor)
+        {
+            const uint64_t sampleStride = observation.getNrBeams() * nrChannels;
+
+            transposeSampleMajor(input + (firstSample * sampleStride) + (beam * nrChannels), output.at(beam) + firstSample, nrChannels, nrSamples, nrPaddedSamples, false, sampleStride);
+        }
+        else
+        {
+            transposeSampleMajor(input + (((static_cast<uint64_t>(beam) * observation.getNrSamplesPerBatch()) + firstSample) * nrChannels), output.at(beam) + firstSample, nrChannels, nrSamples, nrPaddedSamples, false);
+        }
+    });
+}
+
+template <typename T>
+void transposeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, T *output, const unsigned int firstSample, unsigned int nrSamples)
+{
+    if (nrSamples == 0)
+    {
+        nrSamples = observation.getNrSamplesPerBatch() - firstSample;
+    }
+    if (inputBits >= 8)
+    {
+        transposeSampleMajor(input, output + firstSample, observation.getNrChannels(), nrSamples, observation.getNrSamplesPerBatch(false, padding / sizeof(T)), true);
+    }
+    else if ((observation.getNrChannels() % (8 / inputBits) == 0) && (nrSamples % (8 / inputBits) == 0))
+    {
+        transposePackedSIGPROC(observation, padding, inputBits, reinterpret_cast<const uint8_t *>(input), reinterpret_cast<uint8_t *>(output), firstSample, nrSamples);
+    }
+    else
+    {
+        // Some bytes contain items from two different samples, move one item at a time
+        const unsigned int itemsPerByte = 8 / inputBits;
+        const uint64_t nrPaddedBytes = isa::utils::pad(observation.getNrSamplesPerBatch() / itemsPerByte, padding / sizeof(T));
+        const uint8_t mask = (1 << inputBits) - 1;
+        const uint64_t nrItems = static_cast<uint64_t>(nrSamples) * observation.getNrChannels();
+        const uint8_t *inputBytes = reinterpret_cast<const uint8_t *>(input);
+        uint8_t *outputBytes = reinterpret_cast<uint8_t *>(output);
+
+        for (uint64_t item = 0; item < nrItems; item++)
+        {
+            unsigned int channel = (observation.getNrChannels() - 1) - (item % observation.getNrChannels());
+            unsigned int sample = firstSample + (item / observation.getNrChannels());
+            uint8_t value = (inputBytes[item / itemsPerByte] >> ((item % itemsPerByte) * inputBits)) & mask;
+            uint8_t &outputByte = outputBytes[(static_cast<uint64_t>(channel) * nrPaddedBytes) + (sample / itemsPerByte)];
+
+            outputByte = (outputByte & ~(mask << ((sample % itemsPerByte) * inputBits))) | (value << ((sample % itemsPerByte) * inputBits));
+        }
+    }
+}
+
+inline uint64_t transposePackedMatrices(uint64_t word, const uint8_t inputBits)
+{
+    // Swap the off-diagonal blocks of each matrix, halving the block size at every step
+    auto swapBlocks = [&word](const uint64_t mask, const unsigned int distance) {
+        uint64_t swap = ((word >> distance) ^ word) & mask;
+        word ^= swap ^ (swap << distance);
+    };
+
+    switch (inputBits)
+    {
+        case 1:
+            swapBlocks(0x00000000F0F0F0F0ULL, 28);
+            swapBlocks(0x0000CCCC0000CCCCULL, 14);
+            swapBlocks(0x00AA00AA00AA00AAULL, 7);
+            break;
+        case 2:
+            swapBlocks(0x0000F0F00000F0F0ULL, 12);
+            swapBlocks(0x00CC00CC00CC00CCULL, 6);
+            break;
+        case 4:
+            swapBlocks(0x00F000F000F000F0ULL, 4);
+            break;
+        default:
+            break;
+    }
+    return word;
+}
+
+inline void transposePackedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const uint8_t *input, uint8_t *output, const unsigned int firstSample, const unsigned int nrSamples)
+{
+    // Each byte of a sample is a row of a square matrix of packed items; eight bytes are transposed together
+    const unsigned int itemsPerByte = 8 / inputBits;
+    const unsigned int matricesPerWord = 8 / itemsPerByte;
+    const unsigned int nrChannels = observation.getNrChannels();
+    const unsigned int nrInputBytes = nrChannels / itemsPerByte;
+    const unsigned int nrOutputBytes = nrSamples / itemsPerByte;
+    const uint64_t nrPaddedBytes = isa::utils::pad(observation.getNrSamplesPerBatch() / itemsPerByte, padding);
+    const unsigned int tileSize = 64;
+
+    output += firstSample / itemsPerByte;
+
+    for (unsigned int byteTile = 0; byteTile < nrOutputBytes; byteTile += tileSize)
+    {
+        const unsigned int tileBytes = std::min(tileSize, nrOutputBytes - byteTile);
+
+        for (unsigned int inputByte = 0; inputByte < nrInputBytes; inputByte += matricesPerWord)
+        {
+            const unsigned int nrMatrices = std::min(matricesPerWord, nrInputBytes - inputByte);
+
+            for (unsigned int outputByte = byteTile; outputByte < byteTile + tileBytes; outputByte++)
+            {
+                uint64_t word = 0;
+
+                for (unsigned int row = 0; row < itemsPerByte; row++)
+                {
+                    const uint8_t *sample = input + (static_cast<uint64_t>((outputByte * itemsPerByte) + row) * nrInputBytes) + inputByte;
+
+                    for (unsigned int matrix = 0; matrix < nrMatrices; matrix++)
+                    {
+                        word |= static_cast<uint64_t>(sample[matrix]) << (((matrix * itemsPerByte) + row) * 8);
+                    }
+                }
+                word = transposePackedMatrices(word, inputBits);
+                for (unsigned int item = 0; item < nrMatrices * itemsPerByte; item++)
+                {
+                    const unsigned int channel = (nrChannels - 1) - ((inputByte * itemsPerByte) + item);
+
+                    output[(static_cast<uint64_t>(channel) * nrPaddedBytes) + outputByte] = static_cast<uint8_t>(word >> (item * 8));
+                }
+            }
+        }
+    }
+}
+
+template <typename O>
+inline std::uint64_t getReducedBatchSize(const Observation &observation, const unsigned int padding, const bool subbands)
+{
+    const unsigned int nrRows = subbands ? observation.getNrSubbands() : observation.getNrChannels();
+
+    return static_cast<std::uint64_t>(nrRows) * isa::utils::pad(observation.getNrSamplesPerBatch() / std::max(observation.getDownsampling(), 1u), padding / sizeof(O));
+}
+
+template <typename T, typename O>
+void reduceSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, O *output, const bool subbands)
+{
+    // Sums are accumulated in a tile of few output samples for all rows, then copied to the rows
+    const unsigned int nrChannels = observation.getNrChannels();
+    const unsigned int nrChannelsPerRow = subbands ? observation.getNrChannelsPerSubband() : 1;
+    const unsigned int downsampling = std::max(observation.getDownsampling(), 1u);
+    const unsigned int nrOutputSamples = observation.getNrSamplesPerBatch() / downsampling;
+    const uint64_t nrPaddedSamples = isa::utils::pad(nrOutputSamples, padding / sizeof(O));
+    const unsigned int tileSamples = 16;
+
+    if ((nrChannelsPerRow == 0) || (nrChannels % nrChannelsPerRow != 0))
+    {
+        throw FileError("ERROR: the channels cannot be divided in " + std::to_string(observation.getNrSubbands()) + " subbands.");
+    }
+    const unsigned int nrRows = nrChannels / nrChannelsPerRow;
+    std::vector<O> tile(static_cast<uint64_t>(nrRows) * tileSamples);
+    std::vector<uint8_t> unpacked(inputBits < 8 ? nrChannels : 0);
+    auto accumulate = [&](const auto *sample, const unsigned int tileSample) {
+        // The channels of the file are in reverse order
+        const auto *item = sample + (nrChannels - 1);
+
+        for (unsigned int row = 0; row < nrRows; row++)
+        {
+            O sum = 0;
+
+            for (unsigned int channel = 0; channel < nrChannelsPerRow; channel++)
+            {
+                sum += static_cast<O>(*item);
+                item--;
+            }
+            tile[(static_cast<uint64_t>(row) * tileSamples) + tileSample] += sum;
+        }
+    };
+
+    for (unsigned int firstSample = 0; firstSample < nrOutputSamples; firstSample += tileSamples)
+    {
+        const unsigned int nrTileSamples = std::min(tileSamples, nrOutputSamples - firstSample);
+
+        std::fill(tile.begin(), tile.end(), 0);
+        for (unsigned int tileSample = 0; tileSample < nrTileSamples; tileSample++)
+        {
+            for (unsigned int step = 0; step < downsampling; step++)
+            {
+                const uint64_t sample = (static_cast<uint64_t>(firstSample + tileSample) * downsampling) + step;
+
+                if (inputBits >= 8)
+                {
+                    accumulate(input + (sample * nrChannels), tileSample);
+                }
+                else
+                {
+                    const unsigned int itemsPerByte = 8 / inputBits;
+                    const uint8_t mask = (1 << inputBits) - 1;
+                    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(input);
+
+                    for (unsigned int channel = 0; channel < nrChannels; channel++)
+                    {
+                        const uint64_t item = (sample * nrChannels) + channel;
+
+                        unpacked[channel] = (bytes[item / itemsPerByte] >> ((item % itemsPerByte) * inputBits)) & mask;
+                    }
+                    accumulate(unpacked.data(), tileSample);
+                }
+            }
+        }
+        for (unsigned int row = 0; row < nrRows; row++)
+        {
+            std::memcpy(output + (row * nrPaddedSamples) + firstSample, tile.data() + (static_cast<uint64_t>(row) * tileSamples), nrTileSamples * sizeof(O));
+        }
+    }
+}
+
+template <typename T, typename O>
+void readReducedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<O *> &data, const bool subbands, const unsigned int firstBatch)
+{
+    std::ifstream inputFile;
+    std::vector<T> batchBuffer(getSIGPROCBatchSize<T>(observation, inputBits) / sizeof(T));
+
+    inputFile.open(inputFilename.c_str(), std::ios::binary);
+    if (!inputFile)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    inputFile.exceptions(std::ifstream::failbit);
+    inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(firstBatch) * getSIGPROCBatchSize<T>(observation, inputBits)), std::ios::beg);
+    for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
+    {
+        inputFile.read(reinterpret_cast<char *>(batchBuffer.data()), batchBuffer.size() * sizeof(T));
+        reduceSIGPROC(observation, padding, inputBits, batchBuffer.data(), data.at(batch), subbands);
+    }
+    inputFile.close();
+}
+
+template <typename T, typename O>
+void readReducedSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<O> *data, const bool subbands, const unsigned int batch)
+{
+    std::ifstream inputFile;
+    std::vector<T> batchBuffer(getSIGPROCBatchSize<T>(observation, inputBits) / sizeof(T));
+
+    inputFile.open(inputFilename.c_str(), std::ios::binary);
+    if (!inputFile)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    inputFile.exceptions(std::ifstream::failbit);
+    if (data->size() < getReducedBatchSize<O>(observation, padding, subbands))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a reduced batch.");
+    }
+    inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(batch) * getSIGPROCBatchSize<T>(observation, inputBits)), std::ios::beg);
+    inputFile.read(reinterpret_cast<char *>(batchBuffer.data()), batchBuffer.size() * sizeof(T));
+    reduceSIGPROC(observation, padding, inputBits, batchBuffer.data(), data->data(), subbands);
+    inputFile.close();
+}
+
+template <typename T, typename O>
+void readReducedSIGPROCParallel(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, const std::vector<O *> &data, const bool subbands, unsigned int nrThreads, const unsigned int firstBatch)
+{
+    const uint64_t batchSize = getSIGPROCBatchSize<T>(observation, inputBits);
+    const uint64_t firstOffset = bytesToSkip + (static_cast<uint64_t>(firstBatch) * batchSize);
+    int inputFile = open(inputFilename.c_str(), O_RDONLY);
+
+    if (inputFile < 0)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    if (observation.getNrBatches() == 0)
+    {
+        close(inputFile);
+        return;
+    }
+    if (nrThreads == 0)
+    {
+        nrThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    const unsigned int nrWorkers = std::min(nrThreads, observation.getNrBatches());
+    try
+    {
+        // Batches are distributed round-robin, so that each worker reuses the same buffer
+        parallelFor(nrWorkers, nrWorkers, [&](const uint64_t worker) {
+            std::vector<T> buffer((batchSize / sizeof(T)) + 1);
+
+            for (uint64_t batch = worker; batch < observation.getNrBatches(); batch += nrWorkers)
+            {
+                readFileAt(inputFile, buffer.data(), batchSize, firstOffset + (batch * batchSize));
+                reduceSIGPROC(observation, padding, inputBits, buffer.data(), data.at(batch), subbands);
+            }
+        });
+    }
+    catch (...)
+    {
+        close(inputFile);
+        throw;
+    }
+    close(inputFile);
+}
+
+template <typename T>
+inline std::uint64_t getCompactedBatchSize(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::vector<unsigned int> &channelMap)
+{
+    if (observation.getNrChannels() == 0)
+    {
+        return 0;
+    }
+    return (getPaddedBatchSize<T>(observation, padding, inputBits) / observation.getNrChannels()) * channelMap.size();
+}
+
+template <typename T>
+void compactSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, T *output, const std::vector<unsigned int> &channelMap)
+{
+    // Tiles of samples are small enough to stay in cache while their kept channels are gathered
+    const unsigned int nrChannels = observation.getNrChannels();
+    const uint64_t nrRowItems = getPaddedBatchSize<T>(observation, padding, inputBits) / nrChannels;
+    const unsigned int tileSamples = 64;
+
+    for (const unsigned int channel : channelMap)
     {
-        if (inputBits >= 8)
+        if (channel >= nrChannels)
         {
-            inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(firstBatch - 1) * observation.getNrChannels() * observation.getNrSamplesPerBatch() * sizeof(T)), std::ios::beg);
+            throw FileError("ERROR: channel " + std::to_string(channel) + " of the channel map is not part of the observation.");
         }
-        else
+    }
+    if (inputBits >= 8)
+    {
+        for (unsigned int firstSample = 0; firstSample < observation.getNrSamplesPerBatch(); firstSample += tileSamples)
         {
-            inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(firstBatch - 1) * observation.getNrChannels() * observation.getNrSamplesPerBatch() / (8.0 / inputBits) * sizeof(T)), std::ios::beg);
+            const unsigned int nrTileSamples = std::min(tileSamples, observation.getNrSamplesPerBatch() - firstSample);
+            const T *tile = input + (static_cast<uint64_t>(firstSample) * nrChannels);
+
+            for (uint64_t row = 0; row < channelMap.size(); row++)
+            {
+                const T *inputItem = tile + ((nrChannels - 1) - channelMap[row]);
+                T *outputItem = output + (row * nrRowItems) + firstSample;
+
+                for (unsigned int sample = 0; sample < nrTileSamples; sample++)
+                {
+                    outputItem[sample] = inputItem[static_cast<uint64_t>(sample) * nrChannels];
+                }
+            }
         }
     }
     else
     {
-        inputFile.seekg(bytesToSkip, std::ios::beg);
-    }
-    buffer = new char[BUFFER_DIM];
-    for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
-    {
-        if (inputBits >= 8)
+        // Every output byte packs the items of consecutive samples of one channel
+        const unsigned int itemsPerByte = 8 / inputBits;
+        const unsigned int nrOutputBytes = observation.getNrSamplesPerBatch() / itemsPerByte;
+        const uint8_t mask = (1 << inputBits) - 1;
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(input);
+        uint8_t *outputBytes = reinterpret_cast<uint8_t *>(output);
+
+        for (unsigned int firstByte = 0; firstByte < nrOutputBytes; firstByte += tileSamples)
         {
-            data.at(batch) = new std::vector<T>(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)));
-            for (unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++)
+            const unsigned int nrTileBytes = std::min(tileSamples, nrOutputBytes - firstByte);
+
+            for (uint64_t row = 0; row < channelMap.size(); row++)
             {
-                for (unsigned int channel = observation.getNrChannels(); channel > 0; channel--)
+                const unsigned int channel = (nrChannels - 1) - channelMap[row];
+
+                for (unsigned int outputByte = firstByte; outputByte < firstByte + nrTileBytes; outputByte++)
                 {
-                    inputFile.read(buffer, BUFFER_DIM);
-                    data.at(batch)->at((static_cast<uint64_t>(channel - 1) * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + sample) = *(reinterpret_cast<T *>(buffer));
+                    uint8_t value = 0;
+
+                    for (unsigned int item = 0; item < itemsPerByte; item++)
+                    {
+                        const uint64_t inputItem = (static_cast<uint64_t>((outputByte * itemsPerByte) + item) * nrChannels) + channel;
+
+                        value |= ((bytes[inputItem / itemsPerByte] >> ((inputItem % itemsPerByte) * inputBits)) & mask) << (item * inputBits);
+                    }
+                    outputBytes[(row * nrRowItems) + outputByte] = value;
                 }
             }
         }
-        else
+    }
+}
+
+template <typename O>
+inline void convertFloats(const float *input, O *output, const uint64_t nrItems)
+{
+    for (uint64_t item = 0; item < nrItems; item++)
+    {
+        output[item] = static_cast<O>(input[item]);
+    }
+}
+
+inline void convertFloats(const float *input, half *output, const uint64_t nrItems)
+{
+    floatToHalf(input, output, nrItems);
+}
+
+template <typename T, typename O>
+void convertSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const T *input, O *output, const float scale, const float offset)
+{
+    // The samples of one channel in a tile are gathered in single precision, then converted together
+    const unsigned int nrChannels = observation.getNrChannels();
+    const uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(O));
+    const unsigned int tileSamples = 64;
+    const unsigned int itemsPerByte = (inputBits < 8) ? 8 / inputBits : 1;
+    const uint8_t mask = (inputBits < 8) ? (1 << inputBits) - 1 : 0;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(input);
+    float values[tileSamples];
+
+    for (unsigned int firstSample = 0; firstSample < observation.getNrSamplesPerBatch(); firstSample += tileSamples)
+    {
+        const unsigned int nrTileSamples = std::min(tileSamples, observation.getNrSamplesPerBatch() - firstSample);
+
+        for (unsigned int channel = 0; channel < nrChannels; channel++)
         {
-            data.at(batch) = new std::vector<T>(observation.getNrChannels() * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T)));
-            for (uint64_t byte = 0; byte < static_cast<uint64_t>(observation.getNrSamplesPerBatch() * (observation.getNrChannels() / (8.0 / inputBits))); byte++)
+            const unsigned int fileChannel = (nrChannels - 1) - channel;
+
+            if (inputBits >= 8)
             {
-                unsigned int channel = (observation.getNrChannels() - 1) - ((byte * (8 / inputBits)) % observation.getNrChannels());
-                unsigned int sample = (byte * (8 / inputBits)) / observation.getNrChannels();
-                unsigned int sampleByte = sample / (8 / inputBits);
-                uint8_t sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
+                const T *inputItem = input + (static_cast<uint64_t>(firstSample) * nrChannels) + fileChannel;
 
-                inputFile.read(buffer, BUFFER_DIM);
-                for (unsigned int item = 0; item < 8 / inputBits; item++)
+                for (unsigned int sample = 0; sample < nrTileSamples; sample++)
                 {
-                    uint8_t channelFirstBit = item * inputBits;
-                    uint8_t sampleBuffer = 0;
+                    values[sample] = (static_cast<float>(inputItem[static_cast<uint64_t>(sample) * nrChannels]) * scale) + offset;
+                }
+            }
+            else
+            {
+                for (unsigned int sample = 0; sample < nrTileSamples; sample++)
+                {
+                    const uint64_t item = (static_cast<uint64_t>(firstSample + sample) * nrChannels) + fileChannel;
 
-                    if (item > channel)
-                    {
-                        // All channels read, the remaining elements are from the next sample
-                        unsigned int channelOffset = 0;
-                        channel = (observation.getNrChannels() - 1);
-                        sample += 1;
-                        sampleByte = sample / (8 / inputBits);
-                        sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
-
-                        while (item < (8 / inputBits))
-                        {
-                            channelFirstBit = item * inputBits;
-                            sampleBuffer = data.at(batch)->at((static_cast<uint64_t>(channel - channelOffset) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte);
-                            for (uint8_t bit = 0; bit < inputBits; bit++)
-                            {
-                                isa::utils::setBit(sampleBuffer, isa::utils::getBit(*buffer, channelFirstBit + bit), sampleFirstBit + bit);
-                            }
-                            data.at(batch)->at((static_cast<uint64_t>(channel - channelOffset) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte) = sampleBuffer;
-                            item++;
-                            channelOffset++;
-                        }
-
-                        break;
-                    }
-                    sampleBuffer = data.at(batch)->at((static_cast<uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte);
-                    for (uint8_t bit = 0; bit < inputBits; bit++)
-                    {
-                        isa::utils::setBit(sampleBuffer, isa::utils::getBit(*buffer, channelFirstBit + bit), sampleFirstBit + bit);
-                    }
-                    data.at(batch)->at((static_cast<uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte) = sampleBuffer;
+                    values[sample] = (static_cast<float>((bytes[item / itemsPerByte] >> ((item % itemsPerByte) * inputBits)) & mask) * scale) + offset;
                 }
             }
+            convertFloats(values, output + (channel * nrPaddedSamples) + firstSample, nrTileSamples);
         }
     }
-    inputFile.close();
+}
+
+template <typename T>
+constexpr std::uint64_t SIGPROCStream<T>::directAlignment;
+
+template <typename T>
+SIGPROCStream<T>::SIGPROCStream(Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::string &inputFilename, const unsigned int subbands, const StreamMode mode) : padding(padding), inputBits(inputBits), mode(mode), inputFile(-1), batch(0)
+{
+    header = readSIGPROCHeader(inputFilename);
+    setSIGPROCObservation(header, observation, subbands);
+    this->observation = observation;
+    batchSize = getSIGPROCBatchSize<T>(observation, inputBits);
+    if (mode == StreamMode::Direct)
+    {
+        inputFile = open(inputFilename.c_str(), O_RDONLY | O_DIRECT);
+        if (inputFile < 0)
+        {
+            this->mode = StreamMode::DropCache;
+        }
+    }
+    if (inputFile < 0)
+    {
+        inputFile = open(inputFilename.c_str(), O_RDONLY);
+    }
+    if (inputFile < 0)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    if (this->mode != StreamMode::Buffered)
+    {
+        posix_fadvise(inputFile, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    try
+    {
+        if (this->mode == StreamMode::Direct)
+        {
+            // Direct reads start and end on block boundaries, so the buffer has room for a block more on each side
+            batchBuffer.reset(1, isa::utils::pad(batchSize, directAlignment) + (2 * directAlignment), std::max(static_cast<std::uint64_t>(padding), directAlignment));
+        }
+        else
+        {
+            batchBuffer.reset(1, batchSize, padding);
+        }
+    }
+    catch (...)
+    {
+        // The destructor does not run if the constructor throws
+        close(inputFile);
+        throw;
+    }
+}
 
-    delete[] buffer;
+template <typename T>
+SIGPROCStream<T>::~SIGPROCStream()
+{
+    close(inputFile);
 }
 
 template <typename T>
-void readSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename, std::vector<T> *data, const unsigned int batch)
+bool SIGPROCStream<T>::next(std::vector<T> *data)
 {
-    std::ifstream inputFile;
-    const unsigned int BUFFER_DIM = sizeof(T);
-    char *buffer = nullptr;
+    if (data->size() < getPaddedBatchSize<T>(observation, padding, inputBits))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a padded batch.");
+    }
+    const uint8_t *buffer = readBatch();
 
-    inputFile.open(inputFilename.c_str(), std::ios::binary);
-    inputFile.exceptions(std::ifstream::failbit);
-    if (!inputFile)
+    if (buffer == nullptr)
     {
-        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+        return false;
     }
-    if (inputBits >= 8)
+    transposeSIGPROC(observation, padding, inputBits, reinterpret_cast<const T *>(buffer), data->data());
+    batch++;
+    return true;
+}
+
+template <typename T>
+template <typename O>
+bool SIGPROCStream<T>::nextReduced(std::vector<O> *data, const bool subbands)
+{
+    if (data->size() < getReducedBatchSize<O>(observation, padding, subbands))
     {
-        inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(batch) * observation.getNrChannels() * observation.getNrSamplesPerBatch() * sizeof(T)), std::ios::beg);
+        throw std::out_of_range("ERROR: the data structure is smaller than a reduced batch.");
     }
-    else
+    const uint8_t *buffer = readBatch();
+
+    if (buffer == nullptr)
     {
-        inputFile.seekg(bytesToSkip + (static_cast<uint64_t>(batch) * observation.getNrChannels() * observation.getNrSamplesPerBatch() / (8.0 / inputBits) * sizeof(T)), std::ios::beg);
+        return false;
     }
-    buffer = new char[BUFFER_DIM];
-    if (inputBits >= 8)
+    reduceSIGPROC(observation, padding, inputBits, reinterpret_cast<const T *>(buffer), data->data(), subbands);
+    batch++;
+    return true;
+}
+
+template <typename T>
+bool SIGPROCStream<T>::nextCompacted(std::vector<T> *data, const std::vector<unsigned int> &channelMap)
+{
+    if (data->size() < getCompactedBatchSize<T>(observation, padding, inputBits, channelMap))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a compacted batch.");
+    }
+    const uint8_t *buffer = readBatch();
+
+    if (buffer == nullptr)
+    {
+        return false;
+    }
+    compactSIGPROC(observation, padding, inputBits, reinterpret_cast<const T *>(buffer), data->data(), channelMap);
+    batch++;
+    return true;
+}
+
+template <typename T>
+template <typename O>
+bool SIGPROCStream<T>::nextConverted(std::vector<O> *data, const float scale, const float offset)
+{
+    if (data->size() < getPaddedBatchSize<O>(observation, padding, sizeof(O) * 8))
+    {
+        throw std::out_of_range("ERROR: the data structure is smaller than a converted batch.");
+    }
+    const uint8_t *buffer = readBatch();
+
+    if (buffer == nullptr)
+    {
+        return false;
+    }
+    convertSIGPROC(observation, padding, inputBits, reinterpret_cast<const T *>(buffer), data->data(), scale, offset);
+    batch++;
+    return true;
+}
+
+template <typename T>
+const uint8_t *SIGPROCStream<T>::readBatch()
+{
+    const std::uint64_t offset = header.headerSize + (static_cast<uint64_t>(batch) * batchSize);
+    uint8_t *buffer = batchBuffer.getSlot(0);
+
+    if (batch >= observation.getNrBatches())
     {
-        for (unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++)
+        return nullptr;
+    }
+    if (mode == StreamMode::Direct)
+    {
+        const std::uint64_t alignedOffset = offset - (offset % directAlignment);
+        const std::uint64_t shift = offset - alignedOffset;
+        std::uint64_t bytesRead = 0;
+
+        // The last block can extend beyond the end of the file, so short reads are fine once the batch is complete
+        while (bytesRead < shift + batchSize)
         {
-            for (unsigned int channel = observation.getNrChannels(); channel > 0; channel--)
+            ssize_t result = pread(inputFile, buffer + bytesRead, isa::utils::pad(shift + batchSize, directAlignment) - bytesRead, alignedOffset + bytesRead);
+
+            if (result < 0 && errno == EINTR)
             {
-                inputFile.read(buffer, BUFFER_DIM);
-                data->at((static_cast<uint64_t>(channel - 1) * observation.getNrSamplesPerBatch()) + sample) = *(reinterpret_cast<T *>(buffer));
+                continue;
             }
+            if (result <= 0)
+            {
+                throw FileError("ERROR: impossible to read batch " + std::to_string(batch) + " of SIGPROC file.");
+            }
+            bytesRead += result;
+        }
+        if (shift % sizeof(T) != 0)
+        {
+            std::memmove(buffer, buffer + shift, batchSize);
+        }
+        else
+        {
+            buffer += shift;
         }
     }
     else
     {
-        for (uint64_t byte = 0; byte < observation.getNrChannels() * observation.getNrSamplesPerBatch() / (8.0 / inputBits); byte++)
+        readFileAt(inputFile, buffer, batchSize, offset);
+        if (mode == StreamMode::DropCache)
         {
-            unsigned int channel = (observation.getNrChannels() - 1) - ((byte * (8 / inputBits)) % observation.getNrChannels());
-            unsigned int sample = (byte * (8 / inputBits)) / observation.getNrChannels();
-            unsigned int sampleByte = sample / (8 / inputBits);
-            uint8_t sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
+            posix_fadvise(inputFile, offset, batchSize, POSIX_FADV_DONTNEED);
+        }
+    }
+    return buffer;
+}
 
-            inputFile.read(buffer, BUFFER_DIM);
-            for (unsigned int item = 0; item < 8 / inputBits; item++)
-            {
-                uint8_t channelFirstBit = item * inputBits;
-                uint8_t sampleBuffer = 0;
+template <typename T>
+void SIGPROCStream<T>::seek(const unsigned int batch)
+{
+    this->batch = batch;
+}
 
-                if (item > channel)
-                {
-                    // All channels read, the remaining elements are from the next sample
-                    unsigned int channelOffset = 0;
-                    channel = (observation.getNrChannels() - 1);
-                    sample += 1;
-                    sampleByte = sample / (8 / inputBits);
-                    sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
-
-                    while (item < (8 / inputBits))
-                    {
-                        channelFirstBit = item * inputBits;
-                        sampleBuffer = data->at((static_cast<uint64_t>(channel - channelOffset) * (observation.getNrSamplesPerBatch() / (8 / inputBits))) + sampleByte);
-                        for (uint8_t bit = 0; bit < inputBits; bit++)
-                        {
-                            isa::utils::setBit(sampleBuffer, isa::utils::getBit(*buffer, channelFirstBit + bit), sampleFirstBit + bit);
-                        }
-                        data->at((static_cast<uint64_t>(channel - channelOffset) * (observation.getNrSamplesPerBatch() / (8 / inputBits))) + sampleByte) = sampleBuffer;
-                        item++;
-                        channelOffset++;
-                    }
+template <typename T>
+inline unsigned int SIGPROCStream<T>::getBatch() const
+{
+    return batch;
+}
 
-                    break;
-                }
-                sampleBuffer = data->at((static_cast<uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte);
-                for (uint8_t bit = 0; bit < inputBits; bit++)
-                {
-                    isa::utils::setBit(sampleBuffer, isa::utils::getBit(*buffer, channelFirstBit + bit), sampleFirstBit + bit);
-                }
-                data->at((static_cast<uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding / sizeof(T))) + sampleByte) = sampleBuffer;
-            }
-        }
-    }
-    inputFile.close();
+template <typename T>
+inline std::uint64_t SIGPROCStream<T>::getHeaderSize() const
+{
+    return header.headerSize;
+}
+
+template <typename T>
+inline const SIGPROCHeader &SIGPROCStream<T>::getHeader() const
+{
+    return header;
+}
+
+template <typename T>
+inline const Observation &SIGPROCStream<T>::getObservation() const
+{
+    return observation;
+}
 
-    delete[] buffer;
+template <typename T>
+inline StreamMode SIGPROCStream<T>::getMode() const
+{
+    return mode;
 }
 
 #ifdef HAVE_HDF5
 template <typename T>
 void readLOFAR(std::string headerFilename, std::string rawFilename, Observation &observation, const unsigned int padding, std::vector<std::vector<T> *> &data, unsigned int nrBatches, unsigned int firstBatch)
 {
-    unsigned int nrSubbands, nrChannels;
-    float minFreq, channelBandwidth;
-    // Read the HDF5 file with the metadata
-    H5::H5File headerFile = H5::H5File(headerFilename, H5F_ACC_RDONLY);
-    H5::FloatType typeDouble = H5::FloatType(H5::PredType::NATIVE_DOUBLE);
-    double valueDouble = 0.0;
-    H5::IntType typeUInt = H5::IntType(H5::PredType::NATIVE_UINT);
-    unsigned int valueUInt = 0;
-
-    H5::Group currentNode = headerFile.openGroup("/");
-    currentNode.openAttribute("OBSERVATION_FREQUENCY_MIN").read(typeDouble, reinterpret_cast<void *>(&valueDouble));
-    minFreq = valueDouble;
-    currentNode = currentNode.openGroup(currentNode.getObjnameByIdx(0));
-    currentNode.openAttribute("TOTAL_INTEGRATION_TIME").read(typeDouble, reinterpret_cast<void *>(&valueDouble));
-    double totalIntegrationTime = valueDouble;
-    currentNode.openAttribute("NOF_BEAMS").read(typeUInt, reinterpret_cast<void *>(&valueUInt));
-    observation.setNrBeams(valueUInt);
-    currentNode = currentNode.openGroup(currentNode.getObjnameByIdx(0));
-    currentNode.openAttribute("NOF_SAMPLES").read(typeUInt, reinterpret_cast<void *>(&valueUInt));
-    unsigned int totalSamples = valueUInt;
-    currentNode.openAttribute("NOF_STATIONS").read(typeUInt, reinterpret_cast<void *>(&valueUInt));
-    observation.setNrStations(valueUInt);
-    currentNode.openAttribute("CHANNELS_PER_SUBBAND").read(typeUInt, reinterpret_cast<void *>(&valueUInt));
-    nrChannels = valueUInt;
-    currentNode.openAttribute("CHANNEL_WIDTH").read(typeDouble, reinterpret_cast<void *>(&valueDouble));
-    channelBandwidth = valueDouble / 1000000;
-    H5::DataSet currentData = currentNode.openDataSet("STOKES_0");
-    currentData.openAttribute("NOF_SUBBANDS").read(typeUInt, reinterpret_cast<void *>(&valueUInt));
-    nrSubbands = valueUInt;
-    headerFile.close();
-
-    observation.setNrSamplesPerBatch(static_cast<unsigned int>(totalSamples / totalIntegrationTime));
-    if (nrBatches == 0)
-    {
-        observation.setNrBatches(static_cast<unsigned int>(totalIntegrationTime));
-    }
-    else
+    std::vector<T *> batches;
+
+    readLOFARHeader(headerFilename, observation, nrBatches, firstBatch);
+    data.resize(observation.getNrBatches());
+    batches.resize(observation.getNrBatches());
+    for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
     {
-        if (static_cast<unsigned int>(totalIntegrationTime) >= (firstBatch + nrBatches))
-        {
-            observation.setNrBatches(nrBatches);
-        }
-        else
-        {
-            observation.setNrBatches(static_cast<unsigned int>(totalIntegrationTime) - firstBatch);
-        }
+        data.at(batch) = new std::vector<T>(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)));
+        batches.at(batch) = data.at(batch)->data();
     }
-    observation.setFrequencyRange(1, nrSubbands * nrChannels, minFreq, channelBandwidth);
+    readLOFARRaw(rawFilename, observation, padding, batches, firstBatch);
+}
+
+template <typename T>
+void readLOFAR(std::string headerFilename, std::string rawFilename, Observation &observation, const unsigned int padding, BatchArena<T> &data, unsigned int nrBatches, unsigned int firstBatch)
+{
+    readLOFARHeader(headerFilename, observation, nrBatches, firstBatch);
+    data.reset(observation.getNrBatches(), observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)), padding);
+    readLOFARRaw(rawFilename, observation, padding, data.getSlots(), firstBatch);
+}
 
-    // Read the raw file with the actual data
+template <typename T>
+void readLOFAR(const std::string &headerFilename, const std::vector<std::vector<std::string>> &rawFilenames, Observation &observation, const unsigned int padding, std::vector<BatchArena<T>> &data, unsigned int nrBatches, unsigned int firstBatch, const unsigned int nrThreads)
+{
+    const LOFARMetadata metadata = getLOFARMetadata(headerFilename);
+
+    checkLOFARBeams(metadata, rawFilenames);
+    setLOFARObservation(metadata, observation, nrBatches, firstBatch);
+    readLOFARBeams(observation, padding, rawFilenames, data, firstBatch, nrThreads);
+}
+#endif // HAVE_HDF5
+
+template <typename T>
+void readLOFARRaw(const std::string &rawFilename, const Observation &observation, const unsigned int padding, const std::vector<T *> &data, unsigned int firstBatch, const unsigned int firstChannel, unsigned int nrFileChannels)
+{
+    static_assert(sizeof(T) == 4, "LOFAR samples are 32 bits wide.");
+    if (nrFileChannels == 0)
+    {
+        nrFileChannels = observation.getNrChannels() - firstChannel;
+    }
+    // Blocks of about 4 MB, and a whole number of transpose tiles
+    const uint64_t sampleSize = static_cast<uint64_t>(nrFileChannels) * sizeof(T);
+    const unsigned int nrBlockSamples = std::min(static_cast<uint64_t>(observation.getNrSamplesPerBatch()), std::max(((4 * 1024 * 1024) / sampleSize) & ~static_cast<uint64_t>(15), static_cast<uint64_t>(16)));
+    const uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+    std::vector<T> block(static_cast<uint64_t>(nrBlockSamples) * nrFileChannels);
     std::ifstream rawFile;
+
     rawFile.open(rawFilename.c_str(), std::ios::binary);
     if (!rawFile)
     {
         throw FileError("Impossible to open " + rawFilename);
     }
-    rawFile.sync_with_stdio(false);
+    rawFile.exceptions(std::ifstream::failbit);
     if (firstBatch > 0)
     {
-        rawFile.seekg(firstBatch * observation.getNrSamplesPerBatch() * nrSubbands * nrChannels, std::ios::beg);
+        rawFile.seekg(static_cast<uint64_t>(firstBatch) * observation.getNrSamplesPerBatch() * sampleSize, std::ios::beg);
     }
-    data.resize(observation.getNrBatches());
-
-    char *word = new char[4];
     for (unsigned int batch = 0; batch < observation.getNrBatches(); batch++)
     {
-        data.at(batch) = new std::vector<T>(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)));
-        for (unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++)
+        // Subbands and their channels are stored in order, so the global channel is the position in the sample
+        for (unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample += nrBlockSamples)
         {
-            for (unsigned int subband = 0; subband < nrSubbands; subband++)
-            {
-                for (unsigned int channel = 0; channel < nrChannels; channel++)
-                {
-                    unsigned int globalChannel = (subband * nrChannels) + channel;
+            const unsigned int nrSamples = std::min(nrBlockSamples, observation.getNrSamplesPerBatch() - sample);
 
-                    rawFile.read(word, 4);
-                    isa::utils::bigEndianToLittleEndian(word);
-                    data.at(batch)->at((globalChannel * observation.getNrSamplesPerBatch(false, padding / sizeof(T))) + sample) = *(reinterpret_cast<T *>(word));
-                }
-            }
+            rawFile.read(reinterpret_cast<char *>(block.data()), nrSamples * sampleSize);
+            swapBytes32(block.data(), static_cast<uint64_t>(nrSamples) * nrFileChannels);
+            transposeSampleMajor(block.data(), data.at(batch) + (firstChannel * nrPaddedSamples) + sample, nrFileChannels, nrSamples, nrPaddedSamples, false);
         }
     }
     rawFile.close();
-    delete[] word;
 }
-#endif // HAVE_HDF5
+
+template <typename T>
+void readLOFARBeams(const Observation &observation, const unsigned int padding, const std::vector<std::vector<std::string>> &rawFilenames, std::vector<BatchArena<T>> &data, const unsigned int firstBatch, const unsigned int nrThreads)
+{
+    std::vector<std::pair<unsigned int, unsigned int>> files;
+
+    data.resize(rawFilenames.size());
+    for (unsigned int beam = 0; beam < rawFilenames.size(); beam++)
+    {
+        if (rawFilenames.at(beam).empty() || (observation.getNrChannels() % rawFilenames.at(beam).size() != 0))
+        {
+            throw FileError("ERROR: the channels of beam " + std::to_string(beam) + " cannot be split over " + std::to_string(rawFilenames.at(beam).size()) + " files.");
+        }
+        data.at(beam).reset(observation.getNrBatches(), observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(T)), padding);
+        for (unsigned int part = 0; part < rawFilenames.at(beam).size(); part++)
+        {
+            files.emplace_back(beam, part);
+        }
+    }
+    // Files write to different beams, or to different channels of the same beam, so they can be read in any order
+    parallelFor(nrThreads, files.size(), [&](const uint64_t file) {
+        const unsigned int beam = files.at(file).first;
+        const unsigned int part = files.at(file).second;
+        const unsigned int nrFileChannels = observation.getNrChannels() / rawFilenames.at(beam).size();
+
+        readLOFARRaw(rawFilenames.at(beam).at(part), observation, padding, data.at(beam).getSlots(), firstBatch, part * nrFileChannels, nrFileChannels);
+    });
+}
+
+inline void swapBytes32(void *data, const uint64_t nrWords)
+{
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(data);
+    uint64_t word = 0;
+
+#ifdef __SSSE3__
+    const __m128i shuffle = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (; word + 4 <= nrWords; word += 4)
+    {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + (word * 4)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes + (word * 4)), _mm_shuffle_epi8(words, shuffle));
+    }
+#endif // __SSSE3__
+    for (; word < nrWords; word++)
+    {
+        uint32_t value = 0;
+
+        std::memcpy(&value, bytes + (word * 4), 4);
+        value = __builtin_bswap32(value);
+        std::memcpy(bytes + (word * 4), &value, 4);
+    }
+}
 
 #ifdef HAVE_PSRDADA
 template <typename T>
-inline void readPSRDADA(dada_hdu_t &ringBuffer, std::vector<T> *data)
+PSRDADABlock<T>::PSRDADABlock(dada_hdu_t &ringBuffer) : dataBlock(reinterpret_cast<ipcbuf_t *>(ringBuffer.data_block)), buffer(nullptr), bufferBytes(0)
 {
-    char *buffer = 0;
-    uint64_t bufferBytes = 0;
+    char *block = ipcbuf_get_next_read(dataBlock, &bufferBytes);
 
-    buffer = ipcbuf_get_next_read(reinterpret_cast<ipcbuf_t *>(ringBuffer.data_block), &bufferBytes);
-    if ((buffer == 0) || (bufferBytes == 0))
+    if ((block == 0) || (bufferBytes == 0))
     {
         throw RingBufferError("ERROR: impossible to read the PSRDADA buffer");
     }
-    std::memcpy(reinterpret_cast<void *>(data->data()), reinterpret_cast<const void *>(buffer), data->size() * sizeof(T));
-    if (ipcbuf_mark_cleared(reinterpret_cast<ipcbuf_t *>(ringBuffer.data_block)) < 0)
+    buffer = reinterpret_cast<const T *>(block);
+}
+
+template <typename T>
+PSRDADABlock<T>::PSRDADABlock(PSRDADABlock &&other) noexcept : dataBlock(other.dataBlock), buffer(other.buffer), bufferBytes(other.bufferBytes)
+{
+    other.buffer = nullptr;
+    other.bufferBytes = 0;
+}
+
+template <typename T>
+PSRDADABlock<T>::~PSRDADABlock()
+{
+    if (buffer != nullptr)
+    {
+        // Errors cannot be reported from a destructor; release() reports them
+        ipcbuf_mark_cleared(dataBlock);
+    }
+}
+
+template <typename T>
+inline const T *PSRDADABlock<T>::data() const
+{
+    return buffer;
+}
+
+template <typename T>
+inline std::size_t PSRDADABlock<T>::size() const
+{
+    return bufferBytes / sizeof(T);
+}
+
+template <typename T>
+void PSRDADABlock<T>::release()
+{
+    if (buffer == nullptr)
+    {
+        return;
+    }
+    buffer = nullptr;
+    bufferBytes = 0;
+    if (ipcbuf_mark_cleared(dataBlock) < 0)
     {
         throw RingBufferError("ERROR: impossible to mark the PSRDADA buffer as cleared");
     }
 }
+
+template <typename T>
+inline void readPSRDADA(dada_hdu_t &ringBuffer, std::vector<T> *data)
+{
+    PSRDADABlock<T> block(ringBuffer);
+
+    std::memcpy(reinterpret_cast<void *>(data->data()), reinterpret_cast<const void *>(block.data()), std::min(data->size(), block.size()) * sizeof(T));
+    block.release();
+}
+
+template <typename T>
+void readPSRDADA(dada_hdu_t &ringBuffer, const Observation &observation, const unsigned int padding, const BlockLayout layout, const std::vector<T *> &data, const unsigned int nrThreads)
+{
+    PSRDADABlock<T> block(ringBuffer);
+
+    if (block.size() < static_cast<uint64_t>(observation.getNrBeams()) * observation.getNrSamplesPerBatch() * observation.getNrChannels())
+    {
+        throw RingBufferError("ERROR: the PSRDADA block is smaller than a batch of all beams");
+    }
+    transposeBlock(observation, padding, layout, block.data(), data, nrThreads);
+    block.release();
+}
 #endif // HAVE_PSRDADA
 
 } // namespace AstroData
@@ -0,0 +1,212 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ReadData.hpp"
+#include "BatchArena.hpp"
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief In-process ring buffer, with the same model as a PSRDADA ring buffer.
+ *
+ * The ring buffer has a header block, written once by the producer, and a ring of data blocks.
+ * There is one producer and a fixed number of consumers; every consumer reads every block, and a block
+ * is reused by the producer only once all consumers have cleared it. Producer and consumers synchronize
+ * through atomic counters only, and wait by spinning and yielding the processor.
+ */
+class RingBuffer
+{
+  public:
+    /**
+     * @brief Allocate the ring buffer.
+     *
+     * @param nrBlocks Number of data blocks.
+     * @param blockSize Size, in bytes, of a data block.
+     * @param nrConsumers Number of consumers.
+     * @param padding Padding, in bytes, used to align the data blocks.
+     */
+    RingBuffer(const unsigned int nrBlocks, const std::size_t blockSize, const unsigned int nrConsumers = 1, const unsigned int padding = 64);
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /**
+     * @brief Write the header block; can be done only once.
+     *
+     * @param header The header, as a list of "KEY value" lines.
+     */
+    void setHeader(const std::string &header);
+    /**
+     * @brief Wait for the header block and return it.
+     */
+    const std::string &getHeader() const;
+    /**
+     * @brief Wait for a free data block to write into.
+     *
+     * @return The block, of getBlockSize() bytes.
+     */
+    char *getNextWrite();
+    /**
+     * @brief Make the block returned by getNextWrite() available to the consumers.
+     *
+     * @param bytes Number of bytes written in the block.
+     */
+    void markFilled(const std::size_t bytes);
+    /**
+     * @brief Signal the consumers that no more blocks will be written.
+     */
+    void markEndOfData();
+    /**
+     * @brief Wait for the next full data block of a consumer.
+     *
+     * @param consumer The consumer.
+     * @param bytes Number of bytes in the block.
+     * @return The block, or a null pointer if there are no more blocks.
+     */
+    const char *getNextRead(const unsigned int consumer, std::size_t &bytes);
+    /**
+     * @brief Give back the block returned by getNextRead() to the producer.
+     *
+     * @param consumer The consumer.
+     */
+    void markCleared(const unsigned int consumer);
+    /**
+     * @brief Number of data blocks.
+     */
+    unsigned int getNrBlocks() const;
+    /**
+     * @brief Size, in bytes, of a data block.
+     */
+    std::size_t getBlockSize() const;
+    /**
+     * @brief Number of consumers.
+     */
+    unsigned int getNrConsumers() const;
+
+  private:
+    // Counters are kept in different cache lines, so that consumers do not slow each other down
+    struct Counter
+    {
+        std::atomic<std::uint64_t> value;
+        char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+    };
+
+    BatchArena<char> blocks;
+    std::unique_ptr<std::atomic<std::size_t>[]> blockBytes;
+    std::string header;
+    std::atomic<bool> headerWritten;
+    Counter nrWritten;
+    Counter endOfData;
+    std::unique_ptr<Counter[]> nrRead;
+    unsigned int nrBlocks;
+    std::size_t blockSize;
+    unsigned int nrConsumers;
+};
+
+/**
+ * @brief Read the observation parameters from the header block of a ring buffer.
+ * The header uses the same keys of the PSRDADA header.
+ *
+ * @param observation Object to populate with the observation parameters.
+ * @param ringBuffer The ring buffer.
+ */
+void readRingBufferHeader(Observation &observation, const RingBuffer &ringBuffer);
+/**
+ * @brief Copy the next block of a ring buffer; use getNextRead() to access the block without copying it.
+ *
+ * @tparam T Data type of the block.
+ * @param ringBuffer The ring buffer.
+ * @param consumer The consumer.
+ * @param data Data structure to copy the block into.
+ * @return False if there are no more blocks, true otherwise.
+ */
+template <typename T>
+inline bool readRingBuffer(RingBuffer &ringBuffer, const unsigned int consumer, std::vector<T> *data);
+/**
+ * @brief Read the next block of a ring buffer, containing all beams of a batch, into padded channel-major batches.
+ * The block is transposed straight from the ring buffer, without an intermediate copy.
+ *
+ * @tparam T Data type of the block.
+ * @param ringBuffer The ring buffer.
+ * @param consumer The consumer.
+ * @param observation Object containing the observation parameters, including the number of beams.
+ * @param padding Padding used for cache aligning.
+ * @param layout Order of the items in the block.
+ * @param data One pointer per beam, each to memory large enough for a padded batch.
+ * @param nrThreads Number of threads, zero for all hardware threads.
+ * @return False if there are no more blocks, true otherwise.
+ */
+template <typename T>
+bool readRingBuffer(RingBuffer &ringBuffer, const unsigned int consumer, const Observation &observation, const unsigned int padding, const BlockLayout layout, const std::vector<T *> &data, const unsigned int nrThreads = 0);
+
+// Implementations
+
+inline unsigned int RingBuffer::getNrBlocks() const
+{
+    return nrBlocks;
+}
+
+inline std::size_t RingBuffer::getBlockSize() const
+{
+    return blockSize;
+}
+
+inline unsigned int RingBuffer::getNrConsumers() const
+{
+    return nrConsumers;
+}
+
+template <typename T>
+inline bool readRingBuffer(RingBuffer &ringBuffer, const unsigned int consumer, std::vector<T> *data)
+{
+    std::size_t bytes = 0;
+    const char *block = ringBuffer.getNextRead(consumer, bytes);
+
+    if (block == nullptr)
+    {
+        return false;
+    }
+    std::memcpy(reinterpret_cast<void *>(data->data()), reinterpret_cast<const void *>(block), std::min(data->size() * sizeof(T), bytes));
+    ringBuffer.markCleared(consumer);
+    return true;
+}
+
+template <typename T>
+bool readRingBuffer(RingBuffer &ringBuffer, const unsigned int consumer, const Observation &observation, const unsigned int padding, const BlockLayout layout, const std::vector<T *> &data, const unsigned int nrThreads)
+{
+    std::size_t bytes = 0;
+    const char *block = ringBuffer.getNextRead(consumer, bytes);
+
+    if (block == nullptr)
+    {
+        return false;
+    }
+    if (bytes < static_cast<std::uint64_t>(observation.getNrBeams()) * observation.getNrSamplesPerBatch() * observation.getNrChannels() * sizeof(T))
+    {
+        throw RingBufferError("ERROR: the ring buffer block is smaller than a batch of all beams.");
+    }
+    transposeBlock(observation, padding, layout, reinterpret_cast<const T *>(block), data, nrThreads);
+    ringBuffer.markCleared(consumer);
+    return true;
+}
+
+} // namespace AstroData
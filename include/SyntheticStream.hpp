@@ -0,0 +1,282 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Observation.hpp"
+#include "Generator.hpp"
+#include "Platform.hpp"
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief When SyntheticStream makes its batches available.
+ */
+enum class StreamPacing
+{
+    // A batch is generated as soon as it is requested
+    OnDemand,
+    // A batch is made available only once its last sample would have been observed, as a live beamformer does
+    RealTime
+};
+
+/**
+ * @brief Source of synthetic batches, for all beams, with the same interface of the readers.
+ *
+ * Every batch contains uniform noise, in [baseline, baseline + noiseRange), and the pulses crossing it.
+ * The noise depends only on the seed and on the position of the sample in the stream, so the stream is the same for any number of threads.
+ * With real-time pacing the stream keeps track of how late the batches are delivered, e.g. because the consumer does not keep up.
+ *
+ * @tparam T Data type of the batches; sub-byte data is not supported.
+ */
+template <typename T>
+class SyntheticStream
+{
+  public:
+    /**
+     * @brief Prepare the stream; the first batch is timed from the first call to next().
+     *
+     * @param observation Object containing the observation parameters; the stream ends after getNrBatches() batches, or never if it is zero.
+     * @param padding Padding used for cache aligning.
+     * @param pulses Pulses to inject, each one in the beam it names.
+     * @param pacing When batches are made available.
+     * @param baseline Smallest value of the noise.
+     * @param noiseRange Number of different values of the noise; zero for constant data.
+     * @param seed Seed of the noise.
+     * @param nrThreads Number of threads, zero for all hardware threads.
+     */
+    SyntheticStream(const Observation &observation, const unsigned int padding, const std::vector<SyntheticPulse> &pulses, const StreamPacing pacing = StreamPacing::OnDemand, const float baseline = 0.0f, const unsigned int noiseRange = 25, const std::uint64_t seed = 0, const unsigned int nrThreads = 1);
+    SyntheticStream(const SyntheticStream &) = delete;
+    SyntheticStream &operator=(const SyntheticStream &) = delete;
+
+    /**
+     * @brief Generate the next batch of all beams.
+     *
+     * @param data Data structure to generate data into; beams follow each other, each one of getBatchSize() elements in padded channel-major layout.
+     * @return False if there are no more batches, true otherwise.
+     */
+    bool next(std::vector<T> *data);
+    /**
+     * @brief Generate the next batch of all beams.
+     *
+     * @param data One pointer per beam, each to memory large enough for a padded batch.
+     * @return False if there are no more batches, true otherwise.
+     */
+    bool next(const std::vector<T *> &data);
+    /**
+     * @brief Number of elements, including padding, of the batch of one beam.
+     */
+    std::uint64_t getBatchSize() const;
+    /**
+     * @brief Index of the next batch.
+     */
+    unsigned int getBatch() const;
+    /**
+     * @brief Number of batches made available later than their real-time deadline.
+     */
+    unsigned int getNrLateBatches() const;
+    /**
+     * @brief Largest delay, in seconds, of a batch after its real-time deadline.
+     */
+    double getMaxLateness() const;
+    /**
+     * @brief Sum of the delays, in seconds, of the batches after their real-time deadline.
+     */
+    double getTotalLateness() const;
+    /**
+     * @brief Number of samples per second, per beam, generated since the first batch was requested.
+     */
+    double getThroughput() const;
+
+  private:
+    void inject(const unsigned int beam, const unsigned int channel, T *data) const;
+
+    Observation observation;
+    unsigned int padding;
+    std::vector<SyntheticPulse> pulses;
+    // Delay, in samples, of each pulse in each channel
+    std::vector<std::vector<std::uint64_t>> delays;
+    StreamPacing pacing;
+    float baseline;
+    unsigned int noiseRange;
+    std::uint64_t noiseKey;
+    unsigned int nrThreads;
+    unsigned int batch;
+    unsigned int nrLateBatches;
+    double maxLateness;
+    double totalLateness;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last;
+};
+
+// Implementations
+
+template <typename T>
+SyntheticStream<T>::SyntheticStream(const Observation &observation, const unsigned int padding, const std::vector<SyntheticPulse> &pulses, const StreamPacing pacing, const float baseline, const unsigned int noiseRange, const std::uint64_t seed, const unsigned int nrThreads) : observation(observation), padding(padding), pulses(pulses), pacing(pacing), baseline(baseline), noiseRange(noiseRange), noiseKey(getRandomKey(seed, static_cast<std::uint64_t>(RandomStream::Noise))), nrThreads(nrThreads), batch(0), nrLateBatches(0), maxLateness(0.0), totalLateness(0.0)
+{
+    std::shared_ptr<const std::vector<float>> channelDelays = observation.getChannelDelays();
+
+    delays.resize(pulses.size());
+    for (std::size_t pulse = 0; pulse < pulses.size(); pulse++)
+    {
+        delays.at(pulse).resize(observation.getNrChannels());
+        for (unsigned int channel = 0; channel < observation.getNrChannels(); channel++)
+        {
+            delays.at(pulse).at(channel) = getPulseDelay(channelDelays->at(channel), pulses.at(pulse).DM, observation);
+        }
+    }
+}
+
+template <typename T>
+bool SyntheticStream<T>::next(std::vector<T> *data)
+{
+    std::vector<T *> beams(observation.getNrBeams());
+
+    if (data->size() < beams.size() * getBatchSize())
+    {
+        data->resize(beams.size() * getBatchSize());
+    }
+    for (unsigned int beam = 0; beam < beams.size(); beam++)
+    {
+        beams.at(beam) = data->data() + (beam * getBatchSize());
+    }
+    return next(beams);
+}
+
+template <typename T>
+bool SyntheticStream<T>::next(const std::vector<T *> &data)
+{
+    if ((observation.getNrBatches() > 0) && (batch >= observation.getNrBatches()))
+    {
+        return false;
+    }
+    if (batch == 0)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+    const std::uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+
+    parallelFor(nrThreads, static_cast<std::uint64_t>(observation.getNrBeams()) * observation.getNrChannels(), [&](const std::uint64_t row) {
+        const unsigned int beam = row / observation.getNrChannels();
+        const unsigned int channel = row % observation.getNrChannels();
+        const std::uint64_t firstCounter = ((static_cast<std::uint64_t>(batch) * observation.getNrBeams() * observation.getNrChannels()) + row) * observation.getNrSamplesPerBatch();
+        T *rowData = data.at(beam) + (channel * nrPaddedSamples);
+
+        for (unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++)
+        {
+            if (noiseRange > 0)
+            {
+                rowData[sample] = static_cast<T>(baseline + (getRandomNumber(noiseKey, firstCounter + sample) % noiseRange));
+            }
+            else
+            {
+                rowData[sample] = static_cast<T>(baseline);
+            }
+        }
+        std::fill(rowData + observation.getNrSamplesPerBatch(), rowData + nrPaddedSamples, static_cast<T>(0));
+        inject(beam, channel, rowData);
+    });
+    batch++;
+    if (pacing == StreamPacing::RealTime)
+    {
+        const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(static_cast<double>(batch) * observation.getNrSamplesPerBatch() * observation.getSamplingTime()));
+        const auto now = std::chrono::steady_clock::now();
+
+        if (now > deadline)
+        {
+            const double lateness = std::chrono::duration<double>(now - deadline).count();
+
+            nrLateBatches++;
+            maxLateness = std::max(maxLateness, lateness);
+            totalLateness += lateness;
+        }
+        else
+        {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    last = std::chrono::steady_clock::now();
+    return true;
+}
+
+template <typename T>
+void SyntheticStream<T>::inject(const unsigned int beam, const unsigned int channel, T *data) const
+{
+    const std::uint64_t firstSample = static_cast<std::uint64_t>(batch) * observation.getNrSamplesPerBatch();
+    const std::uint64_t lastSample = firstSample + observation.getNrSamplesPerBatch();
+
+    for (std::size_t pulse = 0; pulse < pulses.size(); pulse++)
+    {
+        if (pulses.at(pulse).beam != beam)
+        {
+            continue;
+        }
+        injectPulse(pulses.at(pulse), delays.at(pulse).at(channel), firstSample, lastSample, [&](const std::uint64_t sample, const double amplitude) {
+            data[sample - firstSample] = static_cast<T>(addSaturated(static_cast<double>(data[sample - firstSample]), amplitude, static_cast<double>(std::numeric_limits<T>::lowest()), static_cast<double>(std::numeric_limits<T>::max())));
+        });
+    }
+}
+
+template <typename T>
+inline std::uint64_t SyntheticStream<T>::getBatchSize() const
+{
+    return static_cast<std::uint64_t>(observation.getNrChannels()) * observation.getNrSamplesPerBatch(false, padding / sizeof(T));
+}
+
+template <typename T>
+inline unsigned int SyntheticStream<T>::getBatch() const
+{
+    return batch;
+}
+
+template <typename T>
+inline unsigned int SyntheticStream<T>::getNrLateBatches() const
+{
+    return nrLateBatches;
+}
+
+template <typename T>
+inline double SyntheticStream<T>::getMaxLateness() const
+{
+    return maxLateness;
+}
+
+template <typename T>
+inline double SyntheticStream<T>::getTotalLateness() const
+{
+    return totalLateness;
+}
+
+template <typename T>
+inline double SyntheticStream<T>::getThroughput() const
+{
+    const double elapsed = std::chrono::duration<double>(last - start).count();
+
+    if ((batch == 0) || (elapsed <= 0.0))
+    {
+        return 0.0;
+    }
+    return static_cast<double>(batch) * observation.getNrSamplesPerBatch() / elapsed;
+}
+
+} // namespace AstroData
@@ -0,0 +1,403 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <future>
+#include <sstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ReadData.hpp"
+
+#pragma once
+
+namespace AstroData
+{
+
+/**
+ * @brief Populate the parameters of a SIGPROC header from the observation parameters.
+ * The other parameters of the header, e.g. the source name, are left untouched.
+ *
+ * @param observation Object containing the observation parameters.
+ * @param outputBits Number of bits each sample is represented with.
+ * @param header The header.
+ */
+void setSIGPROCHeader(const Observation &observation, const uint8_t outputBits, SIGPROCHeader &header);
+/**
+ * @brief Write a SIGPROC header.
+ * Optional parameters, e.g. the source name or the number of samples, are written only when set.
+ *
+ * @param header The header.
+ * @param outputFile The output stream.
+ */
+void writeSIGPROCHeader(const SIGPROCHeader &header, std::ostream &outputFile);
+/**
+ * @brief Write a buffer at a given offset of a file, retrying short and interrupted writes.
+ *
+ * @param fileDescriptor The file.
+ * @param buffer The buffer to write.
+ * @param size Size, in bytes, of the buffer.
+ * @param offset Offset, in bytes, of the buffer in the file.
+ */
+void writeFileAt(const int fileDescriptor, const void *buffer, const std::uint64_t size, const std::uint64_t offset);
+/**
+ * @brief Transpose samples of at least 8 bits from padded channel-major to sample-major layout, in cache tiles.
+ *
+ * @tparam T Data type of the samples.
+ * @param input The channel-major batch.
+ * @param output The samples, each one containing all channels.
+ * @param nrChannels Number of channels.
+ * @param nrSamples Number of samples to transpose.
+ * @param nrPaddedSamples Number of samples of an input channel, including padding.
+ * @param reverseChannels Reverse the order of channels, as required by SIGPROC files.
+ */
+template <typename T>
+void transposeChannelMajor(const T *input, T *output, const unsigned int nrChannels, const unsigned int nrSamples, const uint64_t nrPaddedSamples, const bool reverseChannels);
+/**
+ * @brief Transpose one batch from the channel-major layout to the SIGPROC layout; the reverse of transposeSIGPROC.
+ *
+ * @tparam T Data type of the batch.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param outputBits Number of bits each sample is represented with.
+ * @param input The batch in channel-major layout.
+ * @param output The samples in SIGPROC layout.
+ */
+template <typename T>
+void transposeToSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const T *input, T *output);
+/**
+ * @brief Transpose one batch of packed 1, 2 or 4 bits samples from the channel-major layout to the SIGPROC layout.
+ * The number of channels and of samples per batch must be multiples of the number of items per byte.
+ *
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param outputBits Number of bits each sample is represented with.
+ * @param input The batch in channel-major layout.
+ * @param output The samples in SIGPROC layout.
+ */
+inline void transposePackedChannelMajor(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const uint8_t *input, uint8_t *output);
+
+/**
+ * @brief Sequential writer of SIGPROC filterbank files.
+ *
+ * The header is written when the file is opened, and every batch is transposed in bulk and written with a single large write.
+ * Writes can be asynchronous: a batch is written in the background while the next one is transposed, using two buffers.
+ *
+ * @tparam T Data type of the filterbank file; 8 bits wide for 1, 2 and 4 bits samples.
+ */
+template <typename T>
+class SIGPROCWriter
+{
+  public:
+    /**
+     * @brief Create a SIGPROC filterbank file and write its header.
+     *
+     * @param observation Object containing the observation parameters.
+     * @param padding Padding used for cache aligning.
+     * @param outputBits Number of bits each sample is represented with.
+     * @param outputFilename Name of the filterbank file.
+     * @param header Optional parameters of the header, e.g. the source name; the others are set from the observation.
+     * @param asynchronous Write in the background while the next batch is transposed.
+     */
+    SIGPROCWriter(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const SIGPROCHeader &header = SIGPROCHeader(), const bool asynchronous = true);
+    SIGPROCWriter(const SIGPROCWriter &) = delete;
+    SIGPROCWriter &operator=(const SIGPROCWriter &) = delete;
+    ~SIGPROCWriter();
+
+    /**
+     * @brief Append a batch to the file.
+     *
+     * @param data The batch, in padded channel-major layout.
+     */
+    void write(const T *data);
+    void write(const std::vector<T> &data);
+    /**
+     * @brief Wait for the pending write and close the file.
+     * Errors of asynchronous writes are reported here, or by the next write.
+     */
+    void close();
+    /**
+     * @brief Number of batches written so far.
+     */
+    unsigned int getNrBatches() const;
+    /**
+     * @brief Size, in bytes, of the header of the file.
+     */
+    std::uint64_t getHeaderSize() const;
+
+  private:
+    Observation observation;
+    unsigned int padding;
+    uint8_t outputBits;
+    bool asynchronous;
+    int outputFile;
+    std::uint64_t headerSize;
+    std::uint64_t batchSize;
+    unsigned int batch;
+    BatchArena<uint8_t> buffers;
+    std::future<void> pendingWrite;
+};
+
+/**
+ * @brief Write a full SIGPROC filterbank file; the counterpart of readSIGPROC.
+ *
+ * @tparam T Data type of the filterbank file.
+ * @param observation Object containing the observation parameters.
+ * @param padding Padding used for cache aligning.
+ * @param outputBits Number of bits each sample is represented with.
+ * @param outputFilename Name of the filterbank file.
+ * @param data The batches, in padded channel-major layout.
+ * @param header Optional parameters of the header, e.g. the source name; the others are set from the observation.
+ */
+template <typename T>
+void writeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const std::vector<std::vector<T> *> &data, const SIGPROCHeader &header = SIGPROCHeader());
+template <typename T>
+void writeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const std::vector<T *> &data, const SIGPROCHeader &header = SIGPROCHeader());
+
+// Implementations
+
+template <typename T>
+void transposeChannelMajor(const T *input, T *output, const unsigned int nrChannels, const unsigned int nrSamples, const uint64_t nrPaddedSamples, const bool reverseChannels)
+{
+    // A tile of channels is read one channel row at a time, and written one sample at a time
+    const unsigned int tileChannels = std::max(static_cast<unsigned int>(64 / sizeof(T)), 1u);
+    const unsigned int tileSamples = 64;
+
+    for (unsigned int sampleTile = 0; sampleTile < nrSamples; sampleTile += tileSamples)
+    {
+        const unsigned int nrTileSamples = std::min(tileSamples, nrSamples - sampleTile);
+
+        for (unsigned int channelTile = 0; channelTile < nrChannels; channelTile += tileChannels)
+        {
+            const unsigned int nrTileChannels = std::min(tileChannels, nrChannels - channelTile);
+
+            for (unsigned int channel = channelTile; channel < channelTile + nrTileChannels; channel++)
+            {
+                const T *inputItem = input + (static_cast<uint64_t>(channel) * nrPaddedSamples) + sampleTile;
+                T *outputItem = output + (static_cast<uint64_t>(sampleTile) * nrChannels) + (reverseChannels ? (nrChannels - 1) - channel : channel);
+
+                for (unsigned int sample = 0; sample < nrTileSamples; sample++)
+                {
+                    outputItem[static_cast<uint64_t>(sample) * nrChannels] = inputItem[sample];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void transposeToSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const T *input, T *output)
+{
+    if (outputBits >= 8)
+    {
+        transposeChannelMajor(input, output, observation.getNrChannels(), observation.getNrSamplesPerBatch(), observation.getNrSamplesPerBatch(false, padding / sizeof(T)), true);
+    }
+    else if ((observation.getNrChannels() % (8 / outputBits) == 0) && (observation.getNrSamplesPerBatch() % (8 / outputBits) == 0))
+    {
+        transposePackedChannelMajor(observation, padding, outputBits, reinterpret_cast<const uint8_t *>(input), reinterpret_cast<uint8_t *>(output));
+    }
+    else
+    {
+        // Some bytes contain items from two different samples, move one item at a time
+        const unsigned int itemsPerByte = 8 / outputBits;
+        const uint64_t nrPaddedBytes = isa::utils::pad(observation.getNrSamplesPerBatch() / itemsPerByte, padding / sizeof(T));
+        const uint8_t mask = (1 << outputBits) - 1;
+        const uint64_t nrItems = static_cast<uint64_t>(observation.getNrSamplesPerBatch()) * observation.getNrChannels();
+        const uint8_t *inputBytes = reinterpret_cast<const uint8_t *>(input);
+        uint8_t *outputBytes = reinterpret_cast<uint8_t *>(output);
+
+        for (uint64_t item = 0; item < nrItems; item++)
+        {
+            unsigned int channel = (observation.getNrChannels() - 1) - (item % observation.getNrChannels());
+            unsigned int sample = item / observation.getNrChannels();
+            uint8_t value = (inputBytes[(static_cast<uint64_t>(channel) * nrPaddedBytes) + (sample / itemsPerByte)] >> ((sample % itemsPerByte) * outputBits)) & mask;
+            uint8_t &outputByte = outputBytes[item / itemsPerByte];
+
+            outputByte = (outputByte & ~(mask << ((item % itemsPerByte) * outputBits))) | (value << ((item % itemsPerByte) * outputBits));
+        }
+    }
+}
+
+inline void transposePackedChannelMajor(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const uint8_t *input, uint8_t *output)
+{
+    // The packed matrices are transposed exactly as when reading, only the roles of channels and samples are swapped
+    const unsigned int itemsPerByte = 8 / outputBits;
+    const unsigned int matricesPerWord = 8 / itemsPerByte;
+    const unsigned int nrChannels = observation.getNrChannels();
+    const unsigned int nrOutputBytes = nrChannels / itemsPerByte;
+    const unsigned int nrInputBytes = observation.getNrSamplesPerBatch() / itemsPerByte;
+    const uint64_t nrPaddedBytes = isa::utils::pad(nrInputBytes, padding);
+
+    for (unsigned int inputByte = 0; inputByte < nrInputBytes; inputByte++)
+    {
+        for (unsigned int outputByte = 0; outputByte < nrOutputBytes; outputByte += matricesPerWord)
+        {
+            const unsigned int nrMatrices = std::min(matricesPerWord, nrOutputBytes - outputByte);
+            uint64_t word = 0;
+
+            for (unsigned int item = 0; item < nrMatrices * itemsPerByte; item++)
+            {
+                const unsigned int channel = (nrChannels - 1) - ((outputByte * itemsPerByte) + item);
+
+                word |= static_cast<uint64_t>(input[(static_cast<uint64_t>(channel) * nrPaddedBytes) + inputByte]) << (item * 8);
+            }
+            word = transposePackedMatrices(word, outputBits);
+            for (unsigned int row = 0; row < itemsPerByte; row++)
+            {
+                uint8_t *sample = output + (static_cast<uint64_t>((inputByte * itemsPerByte) + row) * nrOutputBytes) + outputByte;
+
+                for (unsigned int matrix = 0; matrix < nrMatrices; matrix++)
+                {
+                    sample[matrix] = static_cast<uint8_t>(word >> (((matrix * itemsPerByte) + row) * 8));
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+SIGPROCWriter<T>::SIGPROCWriter(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const SIGPROCHeader &header, const bool asynchronous) : observation(observation), padding(padding), outputBits(outputBits), asynchronous(asynchronous), outputFile(-1), batch(0)
+{
+    SIGPROCHeader fullHeader = header;
+    std::ostringstream headerBuffer;
+
+    if (((outputBits >= 8) && (outputBits != sizeof(T) * 8)) || ((outputBits < 8) && ((sizeof(T) != 1) || (8 % outputBits != 0))))
+    {
+        throw FileError("ERROR: SIGPROC samples of " + std::to_string(outputBits) + " bits cannot be written from this data type.");
+    }
+    setSIGPROCHeader(observation, outputBits, fullHeader);
+    writeSIGPROCHeader(fullHeader, headerBuffer);
+    headerSize = headerBuffer.str().size();
+    batchSize = getSIGPROCBatchSize<T>(observation, outputBits);
+    outputFile = open(outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outputFile < 0)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + outputFilename + "\".");
+    }
+    writeFileAt(outputFile, headerBuffer.str().data(), headerSize, 0);
+    buffers.reset(asynchronous ? 2 : 1, isa::utils::pad(batchSize, sizeof(T)), padding);
+}
+
+template <typename T>
+SIGPROCWriter<T>::~SIGPROCWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // Destructors must not throw; call close() to be notified of errors
+    }
+}
+
+template <typename T>
+void SIGPROCWriter<T>::write(const T *data)
+{
+    const std::uint64_t offset = headerSize + (static_cast<uint64_t>(batch) * batchSize);
+    uint8_t *buffer = buffers.getSlot(batch % buffers.getNrSlots());
+
+    if (outputFile < 0)
+    {
+        throw FileError("ERROR: the SIGPROC file is closed.");
+    }
+    // The buffer of this batch was last used two batches ago, and its write has already completed
+    transposeToSIGPROC(observation, padding, outputBits, data, reinterpret_cast<T *>(buffer));
+    if (pendingWrite.valid())
+    {
+        pendingWrite.get();
+    }
+    if (asynchronous)
+    {
+        const int file = outputFile;
+        const std::uint64_t size = batchSize;
+
+        pendingWrite = std::async(std::launch::async, [file, buffer, size, offset]() { writeFileAt(file, buffer, size, offset); });
+    }
+    else
+    {
+        writeFileAt(outputFile, buffer, batchSize, offset);
+    }
+    batch++;
+}
+
+template <typename T>
+inline void SIGPROCWriter<T>::write(const std::vector<T> &data)
+{
+    write(data.data());
+}
+
+template <typename T>
+void SIGPROCWriter<T>::close()
+{
+    if (outputFile < 0)
+    {
+        return;
+    }
+    try
+    {
+        if (pendingWrite.valid())
+        {
+            pendingWrite.get();
+        }
+    }
+    catch (...)
+    {
+        ::close(outputFile);
+        outputFile = -1;
+        throw;
+    }
+    ::close(outputFile);
+    outputFile = -1;
+}
+
+template <typename T>
+inline unsigned int SIGPROCWriter<T>::getNrBatches() const
+{
+    return batch;
+}
+
+template <typename T>
+inline std::uint64_t SIGPROCWriter<T>::getHeaderSize() const
+{
+    return headerSize;
+}
+
+template <typename T>
+void writeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const std::vector<std::vector<T> *> &data, const SIGPROCHeader &header)
+{
+    std::vector<T *> batches;
+
+    for (auto batch : data)
+    {
+        batches.push_back(batch->data());
+    }
+    writeSIGPROC(observation, padding, outputBits, outputFilename, batches, header);
+}
+
+template <typename T>
+void writeSIGPROC(const Observation &observation, const unsigned int padding, const uint8_t outputBits, const std::string &outputFilename, const std::vector<T *> &data, const SIGPROCHeader &header)
+{
+    SIGPROCWriter<T> writer(observation, padding, outputBits, outputFilename, header);
+
+    for (auto batch : data)
+    {
+        writer.write(batch);
+    }
+    writer.close();
+}
+
+} // namespace AstroData
@@ -0,0 +1,390 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <BatchFile.hpp>
+
+namespace AstroData
+{
+
+// Identification of batch files, and version of the format
+static const char batchFileMagic[8] = {'A', 'S', 'T', 'R', 'O', 'D', 'A', 'T'};
+static const std::uint32_t batchFileVersion = 1;
+
+BatchFile::BatchFile(const std::string &inputFilename) : padding(0), inputBits(0), elementSize(0), batchSize(0), mapping(nullptr), mappingSize(0)
+{
+    int fileDescriptor = -1;
+    struct stat fileStatus;
+    void *address = MAP_FAILED;
+    std::uint32_t value = 0;
+    std::uint32_t nrBatches = 0;
+    std::uint64_t indexOffset = 0;
+
+    fileDescriptor = open(inputFilename.c_str(), O_RDONLY);
+    if ( fileDescriptor < 0 )
+    {
+        throw FileError("ERROR: impossible to open batch file \"" + inputFilename + "\".");
+    }
+    if ( (fstat(fileDescriptor, &fileStatus) == 0) && (static_cast<std::uint64_t>(fileStatus.st_size) >= batchFileAlignment) )
+    {
+        mappingSize = fileStatus.st_size;
+        address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    }
+    close(fileDescriptor);
+    if ( address == MAP_FAILED )
+    {
+        throw FileError("ERROR: impossible to map batch file \"" + inputFilename + "\".");
+    }
+    mapping = reinterpret_cast<char *>(address);
+    // Batches are accessed in any order, reading ahead is mostly wasted
+    madvise(mapping, mappingSize, MADV_RANDOM);
+    std::memcpy(&value, mapping + 8, sizeof(value));
+    if ( (std::memcmp(mapping, batchFileMagic, sizeof(batchFileMagic)) != 0) || (value != batchFileVersion) )
+    {
+        munmap(mapping, mappingSize);
+        throw FileError("ERROR: \"" + inputFilename + "\" is not a batch file of a supported version.");
+    }
+    std::memcpy(&elementSize, mapping + 12, sizeof(elementSize));
+    std::memcpy(&value, mapping + 16, sizeof(value));
+    inputBits = value;
+    std::memcpy(&padding, mapping + 20, sizeof(padding));
+    std::memcpy(&nrBatches, mapping + 24, sizeof(nrBatches));
+    std::memcpy(&batchSize, mapping + 32, sizeof(batchSize));
+    std::memcpy(&indexOffset, mapping + 40, sizeof(indexOffset));
+    std::memcpy(&value, mapping + 48, sizeof(value));
+    // The header is validated before anything is allocated from its content
+    if ( (indexOffset == 0) || (indexOffset > mappingSize) || (nrBatches > (mappingSize - indexOffset) / sizeof(BatchFileEntry)) || (52 + static_cast<std::uint64_t>(value) > batchFileAlignment) )
+    {
+        munmap(mapping, mappingSize);
+        throw FileError("ERROR: the batch file \"" + inputFilename + "\" is truncated or was not closed.");
+    }
+    index.resize(nrBatches);
+    deserializeObservation(mapping + 52, value, observation);
+    observation.setNrBatches(index.size());
+    std::memcpy(reinterpret_cast<void *>(index.data()), mapping + indexOffset, index.size() * sizeof(BatchFileEntry));
+    for ( auto &entry : index )
+    {
+        if ( (entry.offset + entry.size > indexOffset) || (entry.size > batchSize) )
+        {
+            munmap(mapping, mappingSize);
+            throw FileError("ERROR: the index of the batch file \"" + inputFilename + "\" is corrupted.");
+        }
+    }
+}
+
+BatchFile::~BatchFile() noexcept
+{
+    munmap(mapping, mappingSize);
+}
+
+const BatchFileEntry &BatchFile::getEntry(const unsigned int batch) const
+{
+    if ( batch >= index.size() )
+    {
+        throw FileError("ERROR: batch " + std::to_string(batch) + " is not in the batch file.");
+    }
+    return index.at(batch);
+}
+
+void BatchFile::checkType(const std::size_t size) const
+{
+    if ( size != elementSize )
+    {
+        throw FileError("ERROR: the batch file contains items of " + std::to_string(elementSize) + " bytes.");
+    }
+}
+
+void BatchFile::decode(const unsigned int batch, uint8_t *data) const
+{
+    const BatchFileEntry &entry = getEntry(batch);
+    const uint8_t *chunk = reinterpret_cast<const uint8_t *>(mapping + entry.offset);
+
+    if ( entry.encoding == BatchEncoding::Raw )
+    {
+        std::memcpy(data, chunk, entry.size);
+    }
+    else if ( entry.encoding == BatchEncoding::BitshuffleRLE )
+    {
+        std::vector<uint8_t> planes(batchSize);
+
+        decodeRLE(chunk, entry.size, planes.data(), batchSize);
+        bitunshuffle(planes.data(), data, elementSize, batchSize / elementSize);
+    }
+    else
+    {
+        throw FileError("ERROR: unknown encoding of batch " + std::to_string(batch) + ".");
+    }
+}
+
+void bitshuffle(const uint8_t *input, uint8_t *output, const std::size_t itemSize, const std::uint64_t nrItems)
+{
+    // Eight items at a time, the same byte of each item forms a matrix of 8x8 bits that is transposed
+    const std::uint64_t planeSize = nrItems / 8;
+
+    for ( std::uint64_t group = 0; group < planeSize; group++ )
+    {
+        for ( std::size_t byte = 0; byte < itemSize; byte++ )
+        {
+            std::uint64_t word = 0;
+
+            for ( unsigned int item = 0; item < 8; item++ )
+            {
+                word |= static_cast<std::uint64_t>(input[(((group * 8) + item) * itemSize) + byte]) << (item * 8);
+            }
+            word = transposePackedMatrices(word, 1);
+            for ( unsigned int bit = 0; bit < 8; bit++ )
+            {
+                output[((((byte * 8) + bit) * planeSize)) + group] = static_cast<uint8_t>(word >> (bit * 8));
+            }
+        }
+    }
+}
+
+void bitunshuffle(const uint8_t *input, uint8_t *output, const std::size_t itemSize, const std::uint64_t nrItems)
+{
+    const std::uint64_t planeSize = nrItems / 8;
+
+    for ( std::uint64_t group = 0; group < planeSize; group++ )
+    {
+        for ( std::size_t byte = 0; byte < itemSize; byte++ )
+        {
+            std::uint64_t word = 0;
+
+            for ( unsigned int bit = 0; bit < 8; bit++ )
+            {
+                word |= static_cast<std::uint64_t>(input[(((byte * 8) + bit) * planeSize) + group]) << (bit * 8);
+            }
+            word = transposePackedMatrices(word, 1);
+            for ( unsigned int item = 0; item < 8; item++ )
+            {
+                output[(((group * 8) + item) * itemSize) + byte] = static_cast<uint8_t>(word >> (item * 8));
+            }
+        }
+    }
+}
+
+std::uint64_t encodeRLE(const uint8_t *input, const std::uint64_t size, uint8_t *output, const std::uint64_t maxSize)
+{
+    // Control bytes below 128 precede 1 to 128 literal bytes, the others a run of 2 to 129 equal bytes
+    std::uint64_t inputByte = 0;
+    std::uint64_t outputByte = 0;
+
+    while ( inputByte < size )
+    {
+        std::uint64_t runLength = 1;
+
+        while ( (inputByte + runLength < size) && (runLength < 129) && (input[inputByte + runLength] == input[inputByte]) )
+        {
+            runLength++;
+        }
+        if ( runLength >= 2 )
+        {
+            if ( outputByte + 2 > maxSize )
+            {
+                return 0;
+            }
+            output[outputByte++] = static_cast<uint8_t>(126 + runLength);
+            output[outputByte++] = input[inputByte];
+            inputByte += runLength;
+        }
+        else
+        {
+            std::uint64_t literalLength = 1;
+
+            // Literals end where a run of at least two bytes starts
+            while ( (inputByte + literalLength < size) && (literalLength < 128) && ((inputByte + literalLength + 1 >= size) || (input[inputByte + literalLength] != input[inputByte + literalLength + 1])) )
+            {
+                literalLength++;
+            }
+            if ( outputByte + 1 + literalLength > maxSize )
+            {
+                return 0;
+            }
+            output[outputByte++] = static_cast<uint8_t>(literalLength - 1);
+            std::memcpy(output + outputByte, input + inputByte, literalLength);
+            outputByte += literalLength;
+            inputByte += literalLength;
+        }
+    }
+    return outputByte;
+}
+
+void decodeRLE(const uint8_t *input, const std::uint64_t size, uint8_t *output, const std::uint64_t outputSize)
+{
+    std::uint64_t inputByte = 0;
+    std::uint64_t outputByte = 0;
+
+    while ( inputByte < size )
+    {
+        const uint8_t control = input[inputByte++];
+
+        if ( control < 128 )
+        {
+            const std::uint64_t literalLength = control + 1;
+
+            if ( (inputByte + literalLength > size) || (outputByte + literalLength > outputSize) )
+            {
+                throw FileError("ERROR: corrupted run-length encoded data.");
+            }
+            std::memcpy(output + outputByte, input + inputByte, literalLength);
+            inputByte += literalLength;
+            outputByte += literalLength;
+        }
+        else
+        {
+            const std::uint64_t runLength = control - 126;
+
+            if ( (inputByte >= size) || (outputByte + runLength > outputSize) )
+            {
+                throw FileError("ERROR: corrupted run-length encoded data.");
+            }
+            std::memset(output + outputByte, input[inputByte++], runLength);
+            outputByte += runLength;
+        }
+    }
+    if ( outputByte != outputSize )
+    {
+        throw FileError("ERROR: corrupted run-length encoded data.");
+    }
+}
+
+std::vector<char> serializeObservation(const Observation &observation)
+{
+    // Every parameter is a 32 bits integer or float, preceded by the number of parameters
+    std::vector<char> buffer;
+    auto writeInteger = [&buffer](const std::uint32_t value) {
+        buffer.insert(buffer.end(), reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + sizeof(value));
+    };
+    auto writeFloat = [&buffer](const float value) {
+        buffer.insert(buffer.end(), reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + sizeof(value));
+    };
+
+    writeInteger(0);
+    writeInteger(observation.getNrBatches());
+    writeInteger(observation.getNrStations());
+    writeInteger(observation.getNrBeams());
+    writeInteger(observation.getNrSynthesizedBeams());
+    writeInteger(observation.getDownsampling());
+    writeFloat(observation.getSamplingTime());
+    writeInteger(observation.getNrSamplesPerBatch());
+    writeInteger(observation.getNrSamplesPerBatch(true));
+    writeInteger(observation.getNrSamplesPerDispersedBatch());
+    writeInteger(observation.getNrSamplesPerDispersedBatch(true));
+    writeInteger(observation.getNrSubbands());
+    writeInteger(observation.getNrChannels());
+    writeFloat(observation.getMinFreq());
+    writeFloat(observation.getChannelBandwidth());
+    writeInteger(observation.getNrZappedChannels());
+    writeInteger(observation.getNrDelayBatches());
+    writeInteger(observation.getNrDelayBatches(true));
+    writeInteger(observation.getNrDMs());
+    writeFloat(observation.getFirstDM());
+    writeFloat(observation.getDMStep());
+    writeInteger(observation.getNrDMs(true));
+    writeFloat(observation.getFirstDM(true));
+    writeFloat(observation.getDMStep(true));
+    writeInteger(observation.getNrPeriods());
+    writeInteger(observation.getFirstPeriod());
+    writeInteger(observation.getPeriodStep());
+    writeInteger(observation.getNrBins());
+    const std::uint32_t nrParameters = (buffer.size() / sizeof(std::uint32_t)) - 1;
+    std::memcpy(buffer.data(), &nrParameters, sizeof(nrParameters));
+    return buffer;
+}
+
+void deserializeObservation(const char *buffer, const std::uint64_t size, Observation &observation)
+{
+    std::uint32_t nrParameters = 0;
+    std::uint32_t parameter = 0;
+    // Parameters missing from older files keep their default value
+    auto readInteger = [&](const std::uint32_t defaultValue) {
+        std::uint32_t value = defaultValue;
+
+        if ( (parameter < nrParameters) && ((parameter + 2) * sizeof(value) <= size) )
+        {
+            std::memcpy(&value, buffer + ((parameter + 1) * sizeof(value)), sizeof(value));
+        }
+        parameter++;
+        return value;
+    };
+    auto readFloat = [&](const float defaultValue) {
+        float value = defaultValue;
+
+        if ( (parameter < nrParameters) && ((parameter + 2) * sizeof(value) <= size) )
+        {
+            std::memcpy(&value, buffer + ((parameter + 1) * sizeof(value)), sizeof(value));
+        }
+        parameter++;
+        return value;
+    };
+
+    if ( size >= sizeof(nrParameters) )
+    {
+        std::memcpy(&nrParameters, buffer, sizeof(nrParameters));
+    }
+    observation.setNrBatches(readInteger(observation.getNrBatches()));
+    observation.setNrStations(readInteger(observation.getNrStations()));
+    observation.setNrBeams(readInteger(observation.getNrBeams()));
+    observation.setNrSynthesizedBeams(readInteger(observation.getNrSynthesizedBeams()));
+    observation.setDownsampling(readInteger(observation.getDownsampling()));
+    observation.setSamplingTime(readFloat(observation.getSamplingTime()));
+    observation.setNrSamplesPerBatch(readInteger(observation.getNrSamplesPerBatch()));
+    observation.setNrSamplesPerBatch(readInteger(observation.getNrSamplesPerBatch(true)), true);
+    observation.setNrSamplesPerDispersedBatch(readInteger(observation.getNrSamplesPerDispersedBatch()));
+    observation.setNrSamplesPerDispersedBatch(readInteger(observation.getNrSamplesPerDispersedBatch(true)), true);
+    const unsigned int nrSubbands = readInteger(observation.getNrSubbands());
+    const unsigned int nrChannels = readInteger(observation.getNrChannels());
+    const float minFreq = readFloat(observation.getMinFreq());
+    const float channelBandwidth = readFloat(observation.getChannelBandwidth());
+    observation.setFrequencyRange(nrSubbands, nrChannels, minFreq, channelBandwidth);
+    observation.setNrZappedChannels(readInteger(observation.getNrZappedChannels()));
+    observation.setNrDelayBatches(readInteger(observation.getNrDelayBatches()));
+    observation.setNrDelayBatches(readInteger(observation.getNrDelayBatches(true)), true);
+    const unsigned int nrDMs = readInteger(observation.getNrDMs());
+    const float firstDM = readFloat(observation.getFirstDM());
+    const float DMStep = readFloat(observation.getDMStep());
+    observation.setDMRange(nrDMs, firstDM, DMStep);
+    const unsigned int nrDMsSubbanding = readInteger(observation.getNrDMs(true));
+    const float firstDMSubbanding = readFloat(observation.getFirstDM(true));
+    const float DMStepSubbanding = readFloat(observation.getDMStep(true));
+    observation.setDMRange(nrDMsSubbanding, firstDMSubbanding, DMStepSubbanding, true);
+    const unsigned int nrPeriods = readInteger(observation.getNrPeriods());
+    const unsigned int firstPeriod = readInteger(observation.getFirstPeriod());
+    const unsigned int periodStep = readInteger(observation.getPeriodStep());
+    observation.setPeriodRange(nrPeriods, firstPeriod, periodStep);
+    observation.setNrBins(readInteger(observation.getNrBins()));
+}
+
+std::vector<char> getBatchFileHeader(const Observation &observation, const unsigned int padding, const uint8_t inputBits, const std::uint32_t elementSize, const std::uint64_t batchSize, const unsigned int nrBatches, const std::uint64_t indexOffset)
+{
+    std::vector<char> header(batchFileAlignment, 0);
+    std::vector<char> parameters = serializeObservation(observation);
+    const std::uint32_t bits = inputBits;
+    const std::uint32_t paddingValue = padding;
+    const std::uint32_t nrBatchesValue = nrBatches;
+    const std::uint32_t parametersSize = parameters.size();
+
+    std::memcpy(header.data(), batchFileMagic, sizeof(batchFileMagic));
+    std::memcpy(header.data() + 8, &batchFileVersion, sizeof(batchFileVersion));
+    std::memcpy(header.data() + 12, &elementSize, sizeof(elementSize));
+    std::memcpy(header.data() + 16, &bits, sizeof(bits));
+    std::memcpy(header.data() + 20, &paddingValue, sizeof(paddingValue));
+    std::memcpy(header.data() + 24, &nrBatchesValue, sizeof(nrBatchesValue));
+    std::memcpy(header.data() + 32, &batchSize, sizeof(batchSize));
+    std::memcpy(header.data() + 40, &indexOffset, sizeof(indexOffset));
+    std::memcpy(header.data() + 48, &parametersSize, sizeof(parametersSize));
+    std::memcpy(header.data() + 52, parameters.data(), parameters.size());
+    return header;
+}
+
+} // namespace AstroData
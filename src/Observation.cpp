@@ -14,6 +14,7 @@
 // limitations under the License.
 
 #include <Observation.hpp>
+#include <Platform.hpp>
 
 namespace AstroData {
 
@@ -141,6 +142,70 @@ float Observation::getDMStep(const bool subbanding) const {
   }
 }
 
+std::shared_ptr< const std::vector< float > > Observation::getChannelDelays() const {
+  std::shared_ptr< const std::vector< float > > table = std::atomic_load(&channelDelays);
+
+  if ( !table ) {
+    auto newTable = std::make_shared< std::vector< float > >(nrChannels);
+    const float inverseHighFreq = 1.0f / (maxChannelFreq * maxChannelFreq);
+
+    for ( unsigned int channel = 0; channel < nrChannels; channel++ ) {
+      const float frequency = minChannelFreq + (channel * channelBandwidth);
+
+      newTable->at(channel) = 4148.808f * ((1.0f / (frequency * frequency)) - inverseHighFreq);
+    }
+    table = newTable;
+    std::atomic_store(&channelDelays, table);
+  }
+  return table;
+}
+
+std::shared_ptr< const std::vector< unsigned int > > Observation::getDelays(const bool subbanding, const unsigned int padding) const {
+  std::shared_ptr< const DelayTable > table;
+
+  if ( subbanding ) {
+    table = std::atomic_load(&delays_subbanding);
+  } else {
+    table = std::atomic_load(&delays);
+  }
+  if ( !table || table->padding != padding ) {
+    table = computeDelays(subbanding, padding);
+    if ( subbanding ) {
+      std::atomic_store(&delays_subbanding, table);
+    } else {
+      std::atomic_store(&delays, table);
+    }
+  }
+  // The returned table keeps the whole cache entry alive
+  return std::shared_ptr< const std::vector< unsigned int > >(table, &table->delays);
+}
+
+std::shared_ptr< const Observation::DelayTable > Observation::computeDelays(const bool subbanding, const unsigned int padding) const {
+  auto table = std::make_shared< DelayTable >();
+  std::shared_ptr< const std::vector< float > > perChannel = getChannelDelays();
+  const unsigned int nrPaddedDMs = getNrDMs(subbanding, padding);
+  const float first = getFirstDM(subbanding);
+  const float step = getDMStep(subbanding);
+  const unsigned int dms = getNrDMs(subbanding);
+
+  table->padding = padding;
+  table->delays.resize(static_cast< std::size_t >(nrChannels) * nrPaddedDMs);
+  if ( samplingTime <= 0.0f ) {
+    // Delays cannot be expressed in samples without a sampling time
+    return table;
+  }
+  // Small tables are not worth starting threads for
+  parallelFor(static_cast< std::uint64_t >(nrChannels) * dms > (1 << 16) ? 0 : 1, nrChannels, [&](const std::uint64_t channel) {
+    const double channelDelay = perChannel->at(channel);
+    unsigned int * row = table->delays.data() + (channel * nrPaddedDMs);
+
+    for ( unsigned int dm = 0; dm < dms; dm++ ) {
+      row[dm] = static_cast< unsigned int >(channelDelay * (first + (dm * step)) / samplingTime);
+    }
+  });
+  return table;
+}
+
 unsigned int Observation::getNrPeriods(const unsigned int padding) const {
   if ( padding == 0 ) {
     return nrPeriods;
@@ -174,6 +239,9 @@ void Observation::setFrequencyRange(const unsigned int subbands, const unsigned
   minChannelFreq = baseFrequency;
   maxChannelFreq = baseFrequency + ((channels - 1) * bandwidth);
   channelBandwidth = bandwidth;
+  std::atomic_store(&channelDelays, std::shared_ptr< const std::vector< float > >());
+  std::atomic_store(&delays, std::shared_ptr< const DelayTable >());
+  std::atomic_store(&delays_subbanding, std::shared_ptr< const DelayTable >());
 }
 
 void Observation::setDMRange(const unsigned int dms, const float baseDM, const float step, const bool subbanding) {
@@ -182,11 +250,13 @@ void Observation::setDMRange(const unsigned int dms, const float baseDM, const f
     firstDM_subbanding = baseDM;
     lastDM_subbanding = baseDM + ((dms - 1) * step);
     DMStep_subbanding = step;
+    std::atomic_store(&delays_subbanding, std::shared_ptr< const DelayTable >());
   } else {
     nrDMs = dms;
     firstDM = baseDM;
     lastDM = baseDM + ((dms - 1) * step);
     DMStep = step;
+    std::atomic_store(&delays, std::shared_ptr< const DelayTable >());
   }
 }
 
@@ -15,6 +15,13 @@
 
 #include <Platform.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace AstroData {
 
 FileError::FileError(const std::string & message) : message(message) {}
@@ -63,5 +70,41 @@ void readVectorWidthConf(vectorWidthConf & vectorWidth, const std::string & vect
   }
 }
 
-} // AstroData
+void parallelFor(const unsigned int nrThreads, const std::uint64_t nrItems, const std::function< void(std::uint64_t) > & body) {
+  std::atomic< std::uint64_t > nextItem(0);
+  std::exception_ptr error;
+  std::mutex errorLock;
+  std::vector< std::thread > threads;
+  std::uint64_t nrWorkers = nrThreads;
+
+  if ( nrWorkers == 0 ) {
+    nrWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  nrWorkers = std::min(nrWorkers, nrItems);
+  auto worker = [&]() {
+    for ( std::uint64_t item = nextItem++; item < nrItems; item = nextItem++ ) {
+      try {
+        body(item);
+      } catch ( ... ) {
+        std::lock_guard< std::mutex > guard(errorLock);
 
+        if ( !error ) {
+          error = std::current_exception();
+        }
+        nextItem = nrItems;
+      }
+    }
+  };
+  for ( std::uint64_t thread = 1; thread < nrWorkers; thread++ ) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for ( auto & thread : threads ) {
+    thread.join();
+  }
+  if ( error ) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // AstroData
@@ -26,6 +26,96 @@ const char *RingBufferError::what() const noexcept
     return message.c_str();
 }
 
+SIGPROCMapping::SIGPROCMapping(const Observation &observation, const uint8_t inputBits, const std::uint64_t bytesToSkip, const std::string &inputFilename) : filename(inputFilename), mapping(nullptr), mappingSize(0), headerSize(bytesToSkip), batchSize(0), pageSize(sysconf(_SC_PAGESIZE))
+{
+    int fileDescriptor = -1;
+    struct stat fileStatus;
+    void *address = MAP_FAILED;
+
+    batchSize = static_cast<std::uint64_t>(observation.getNrChannels()) * observation.getNrSamplesPerBatch() * inputBits / 8;
+    fileDescriptor = open(inputFilename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    if (fstat(fileDescriptor, &fileStatus) == 0)
+    {
+        mappingSize = fileStatus.st_size;
+        address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    }
+    // The mapping is independent from the file descriptor
+    close(fileDescriptor);
+    if (address == MAP_FAILED)
+    {
+        throw FileError("ERROR: impossible to map SIGPROC file \"" + inputFilename + "\".");
+    }
+    mapping = reinterpret_cast<char *>(address);
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+}
+
+SIGPROCMapping::~SIGPROCMapping() noexcept
+{
+    munmap(mapping, mappingSize);
+}
+
+std::uint64_t SIGPROCMapping::getNrBatches() const
+{
+    if ((batchSize == 0) || (mappingSize <= headerSize))
+    {
+        return 0;
+    }
+    return (mappingSize - headerSize) / batchSize;
+}
+
+std::uint64_t SIGPROCMapping::getBatchSize() const
+{
+    return batchSize;
+}
+
+void SIGPROCMapping::prefetch(const unsigned int batch, const unsigned int nrBatches) const
+{
+    std::uint64_t begin = headerSize + (batch * batchSize);
+    std::uint64_t end = std::min(begin + (nrBatches * batchSize), mappingSize);
+
+    // Include the pages that are only partially occupied by the batches
+    advise(begin - (begin % pageSize), end, MADV_WILLNEED);
+}
+
+void SIGPROCMapping::release(const unsigned int batch, const unsigned int nrBatches) const
+{
+    std::uint64_t begin = headerSize + (batch * batchSize);
+    std::uint64_t end = std::min(begin + (nrBatches * batchSize), mappingSize);
+
+    // Exclude the pages shared with batches that are not released
+    if (begin % pageSize != 0)
+    {
+        begin += pageSize - (begin % pageSize);
+    }
+    if (end != mappingSize)
+    {
+        end -= end % pageSize;
+    }
+    advise(begin, end, MADV_DONTNEED);
+}
+
+const char *SIGPROCMapping::getBatchAddress(const unsigned int batch) const
+{
+    if (headerSize + ((batch + 1) * batchSize) > mappingSize)
+    {
+        throw FileError("ERROR: batch " + std::to_string(batch) + " is not contained in SIGPROC file \"" + filename + "\".");
+    }
+    return mapping + headerSize + (batch * batchSize);
+}
+
+void SIGPROCMapping::advise(const std::uint64_t begin, const std::uint64_t end, const int advice) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    madvise(mapping + begin, end - begin, advice);
+}
+
 void readZappedChannels(Observation &observation, const std::string &inputFilename, std::vector<unsigned int> &zappedChannels)
 {
     unsigned int nrChannels = 0;
@@ -51,6 +141,21 @@ void readZappedChannels(Observation &observation, const std::string &inputFilena
     observation.setNrZappedChannels(nrChannels);
 }
 
+std::vector<unsigned int> getChannelMap(const Observation &observation, const std::vector<unsigned int> &zappedChannels)
+{
+    std::vector<unsigned int> channelMap;
+
+    channelMap.reserve(observation.getNrChannels());
+    for (unsigned int channel = 0; channel < observation.getNrChannels(); channel++)
+    {
+        if ((channel >= zappedChannels.size()) || (zappedChannels[channel] == 0))
+        {
+            channelMap.push_back(channel);
+        }
+    }
+    return channelMap;
+}
+
 void readIntegrationSteps(const Observation &observation, const std::string &inputFilename, std::set<unsigned int> &integrationSteps)
 {
     std::ifstream input;
@@ -73,313 +178,466 @@ void readIntegrationSteps(const Observation &observation, const std::string &inp
     input.close();
 }
 
+// Headers already parsed, by file name, with the identity and state of the file they were parsed from
+struct CachedSIGPROCHeader
+{
+    SIGPROCHeader header;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec modificationTime;
+};
+static std::map<std::string, CachedSIGPROCHeader> headerCache;
+static std::mutex headerCacheLock;
+
+SIGPROCHeader::SIGPROCHeader() : headerSize(0), telescopeID(0), machineID(0), dataType(0), barycentric(0), pulsarcentric(0), nbits(0), nifs(0), nchans(0), nbeams(0), ibeam(0), nsamples(0), tsamp(0.0), tstart(0.0), fch1(0.0), foff(0.0), refdm(0.0), period(0.0), srcRaj(0.0), srcDej(0.0), azStart(0.0), zaStart(0.0), signedData(false), nbins(0), npuls(0) {}
+
 std::uint64_t getSIGPROCHeaderSize(const std::string &inputFilename)
 {
-    std::uint64_t headerSize = 0;
-    std::uint8_t state = 0;
-    char buffer = '\0';
+    return getSIGPROCHeader(inputFilename).headerSize;
+}
+
+void readSIGPROCHeader(const std::uint64_t, Observation & observation, const std::string & inputFilename, const unsigned int subbands)
+{
+    setSIGPROCObservation(getSIGPROCHeader(inputFilename), observation, subbands);
+}
+
+SIGPROCHeader readSIGPROCHeader(const std::string &inputFilename)
+{
+    SIGPROCHeader header;
     std::ifstream inputFile;
 
     inputFile.open(inputFilename.c_str(), std::ios::binary);
-    inputFile.exceptions(std::ifstream::failbit);
     if ( !inputFile )
     {
         throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
     }
-    while ( inputFile.get(buffer) )
+    header = readSIGPROCHeader(inputFile);
+    inputFile.close();
+    return header;
+}
+
+SIGPROCHeader readSIGPROCHeader(std::istream &inputFile)
+{
+    const std::uint64_t blockSize = 4096;
+    const std::ios::iostate exceptions = inputFile.exceptions();
+    SIGPROCHeader header;
+    std::vector<char> buffer;
+    std::uint64_t bufferSize = 0;
+    std::uint64_t position = 0;
+    std::uint64_t fileSize = 0;
+    std::string keyword;
+
+    // Short reads are expected, as the header is read in blocks
+    inputFile.exceptions(std::ios::goodbit);
+    inputFile.clear();
+    inputFile.seekg(0, std::ios::end);
+    fileSize = inputFile.tellg();
+    inputFile.seekg(0, std::ios::beg);
+    auto fill = [&](const std::uint64_t bytes) {
+        while ( position + bytes > bufferSize )
+        {
+            buffer.resize(bufferSize + blockSize);
+            inputFile.read(buffer.data() + bufferSize, blockSize);
+            if ( inputFile.gcount() == 0 )
+            {
+                inputFile.clear();
+                inputFile.exceptions(exceptions);
+                throw FileError("ERROR: the SIGPROC header is truncated.");
+            }
+            bufferSize += inputFile.gcount();
+        }
+    };
+    auto readInteger = [&]() {
+        std::int32_t value = 0;
+
+        fill(sizeof(value));
+        std::memcpy(&value, buffer.data() + position, sizeof(value));
+        position += sizeof(value);
+        return value;
+    };
+    auto readLong = [&]() {
+        std::int64_t value = 0;
+
+        fill(sizeof(value));
+        std::memcpy(&value, buffer.data() + position, sizeof(value));
+        position += sizeof(value);
+        return value;
+    };
+    auto readChar = [&]() {
+        fill(sizeof(char));
+        position += sizeof(char);
+        return buffer[position - 1];
+    };
+    auto readDouble = [&]() {
+        double value = 0.0;
+
+        fill(sizeof(value));
+        std::memcpy(&value, buffer.data() + position, sizeof(value));
+        position += sizeof(value);
+        return value;
+    };
+    auto readString = [&]() {
+        std::int32_t length = readInteger();
+
+        if ( (length <= 0) || (length > 80) )
+        {
+            inputFile.clear();
+            inputFile.exceptions(exceptions);
+            throw FileError("ERROR: invalid string in the SIGPROC header.");
+        }
+        fill(length);
+        position += length;
+        return std::string(buffer.data() + position - length, length);
+    };
+
+    if ( readString() != "HEADER_START" )
     {
-        switch ( buffer )
+        inputFile.clear();
+        inputFile.exceptions(exceptions);
+        throw FileError("ERROR: the SIGPROC header does not start with HEADER_START.");
+    }
+    for ( keyword = readString(); keyword != "HEADER_END"; keyword = readString() )
+    {
+        if ( keyword == "telescope_id" )
         {
-            case 'H':
-                state = 1;
-                break;
-            case 'E':
-                if ( (state == 1) || (state == 4) || (state == 7) )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'A':
-                if ( state == 2 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'D':
-                if ( (state == 3) || (state == 9) )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'R':
-                if ( state == 5 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case '_':
-                if ( state == 6 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'N':
-                if ( state == 8 )
-                {
-                    state++;
-                }
-                else
+            header.telescopeID = readInteger();
+        }
+        else if ( keyword == "machine_id" )
+        {
+            header.machineID = readInteger();
+        }
+        else if ( keyword == "data_type" )
+        {
+            header.dataType = readInteger();
+        }
+        else if ( keyword == "barycentric" )
+        {
+            header.barycentric = readInteger();
+        }
+        else if ( keyword == "pulsarcentric" )
+        {
+            header.pulsarcentric = readInteger();
+        }
+        else if ( keyword == "nbits" )
+        {
+            header.nbits = readInteger();
+        }
+        else if ( keyword == "nifs" )
+        {
+            header.nifs = readInteger();
+        }
+        else if ( keyword == "nchans" )
+        {
+            header.nchans = readInteger();
+        }
+        else if ( keyword == "nbeams" )
+        {
+            header.nbeams = readInteger();
+        }
+        else if ( keyword == "ibeam" )
+        {
+            header.ibeam = readInteger();
+        }
+        else if ( keyword == "nsamples" )
+        {
+            header.nsamples = readInteger();
+        }
+        else if ( keyword == "tsamp" )
+        {
+            header.tsamp = readDouble();
+        }
+        else if ( keyword == "tstart" )
+        {
+            header.tstart = readDouble();
+        }
+        else if ( keyword == "fch1" )
+        {
+            header.fch1 = readDouble();
+        }
+        else if ( keyword == "foff" )
+        {
+            header.foff = readDouble();
+        }
+        else if ( keyword == "refdm" )
+        {
+            header.refdm = readDouble();
+        }
+        else if ( keyword == "period" )
+        {
+            header.period = readDouble();
+        }
+        else if ( keyword == "src_raj" )
+        {
+            header.srcRaj = readDouble();
+        }
+        else if ( keyword == "src_dej" )
+        {
+            header.srcDej = readDouble();
+        }
+        else if ( keyword == "az_start" )
+        {
+            header.azStart = readDouble();
+        }
+        else if ( keyword == "za_start" )
+        {
+            header.zaStart = readDouble();
+        }
+        else if ( keyword == "source_name" )
+        {
+            header.sourceName = readString();
+        }
+        else if ( keyword == "rawdatafile" )
+        {
+            header.rawDataFile = readString();
+        }
+        else if ( keyword == "signed" )
+        {
+            header.signedData = readChar() != 0;
+        }
+        else if ( keyword == "nbins" )
+        {
+            header.nbins = readInteger();
+        }
+        else if ( keyword == "npuls" )
+        {
+            header.npuls = readLong();
+        }
+        else if ( keyword == "fchannel" )
+        {
+            readDouble();
+        }
+        else if ( (keyword != "FREQUENCY_START") && (keyword != "FREQUENCY_END") )
+        {
+            // The size of the value is unknown, so the header ends where the HEADER_END keyword is first found
+            const std::string end = std::string("\x0a\x00\x00\x00", 4) + "HEADER_END";
+
+            while ( true )
+            {
+                auto match = std::search(buffer.begin() + position, buffer.begin() + bufferSize, end.begin(), end.end());
+
+                if ( match != buffer.begin() + bufferSize )
                 {
-                    state = 0;
+                    position = (match - buffer.begin()) + end.size();
+                    break;
                 }
-                break;
-            default:
-                break;
+                // The keyword may be split between two blocks
+                position = std::max(position, bufferSize - std::min(bufferSize, static_cast<std::uint64_t>(end.size() - 1)));
+                fill(bufferSize - position + 1);
+            }
+            break;
         }
-        headerSize++;
-        if ( state == 10 )
+    }
+    header.headerSize = position;
+    // Older files do not store the number of samples
+    if ( (header.nsamples == 0) && (header.nbits > 0) && (header.nchans > 0) && (fileSize > header.headerSize) )
+    {
+        header.nsamples = ((fileSize - header.headerSize) * 8) / (static_cast<std::uint64_t>(header.nbits) * header.nchans * std::max(header.nifs, 1u));
+    }
+    inputFile.clear();
+    inputFile.seekg(header.headerSize, std::ios::beg);
+    inputFile.exceptions(exceptions);
+    return header;
+}
+
+SIGPROCHeader getSIGPROCHeader(const std::string &inputFilename)
+{
+    struct stat fileStatus;
+    CachedSIGPROCHeader cached;
+
+    if ( stat(inputFilename.c_str(), &fileStatus) != 0 )
+    {
+        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+    }
+    {
+        std::lock_guard<std::mutex> guard(headerCacheLock);
+        auto header = headerCache.find(inputFilename);
+
+        // A file that was replaced, or modified, is parsed again
+        if ( (header != headerCache.end()) && (header->second.device == fileStatus.st_dev) && (header->second.inode == fileStatus.st_ino) && (header->second.size == fileStatus.st_size) && (header->second.modificationTime.tv_sec == fileStatus.st_mtim.tv_sec) && (header->second.modificationTime.tv_nsec == fileStatus.st_mtim.tv_nsec) )
         {
-            break;
+            return header->second.header;
         }
     }
-    inputFile.close();
-    return headerSize;
+    cached.header = readSIGPROCHeader(inputFilename);
+    cached.device = fileStatus.st_dev;
+    cached.inode = fileStatus.st_ino;
+    cached.size = fileStatus.st_size;
+    cached.modificationTime = fileStatus.st_mtim;
+    std::lock_guard<std::mutex> guard(headerCacheLock);
+    headerCache[inputFilename] = cached;
+    return cached.header;
 }
 
-void readSIGPROCHeader(const std::uint64_t headerSize, Observation & observation, const std::string & inputFilename, const unsigned int subbands)
+void clearSIGPROCHeaderCache()
+{
+    std::lock_guard<std::mutex> guard(headerCacheLock);
+    headerCache.clear();
+}
+
+void setSIGPROCObservation(const SIGPROCHeader &header, Observation & observation, const unsigned int subbands)
+{
+    observation.setNrSamplesPerBatch(header.nsamples / observation.getNrBatches());
+    observation.setSamplingTime(header.tsamp);
+    observation.setFrequencyRange(subbands, header.nchans, header.fch1 + (header.foff * (header.nchans - 1)), -header.foff);
+}
+
+void readFileAt(const int fileDescriptor, void *buffer, const std::uint64_t size, const std::uint64_t offset)
 {
     std::uint64_t bytesRead = 0;
-    std::uint8_t state = 0;
-    std::ifstream inputFile;
-    // Temporary variables
-    char buffer = '\0';
-    char * temp32 = new char [4];
-    char * temp64 = new char [8];
-    double tsamp = 0.0;
-    unsigned int nsamples = 0;
-    double fch1 = 0.0;
-    double foff = 0.0;
-    unsigned int nchans = 0;
 
+    while ( bytesRead < size )
+    {
+        ssize_t result = pread(fileDescriptor, reinterpret_cast<char *>(buffer) + bytesRead, size - bytesRead, offset + bytesRead);
 
-    inputFile.open(inputFilename.c_str(), std::ios::binary);
-    inputFile.exceptions(std::ifstream::failbit);
-    if ( !inputFile )
+        if ( result < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( result <= 0 )
+        {
+            throw FileError("ERROR: impossible to read " + std::to_string(size) + " bytes at offset " + std::to_string(offset) + ".");
+        }
+        bytesRead += result;
+    }
+}
+
+#ifdef HAVE_HDF5
+static std::map<std::string, LOFARMetadata> metadataCache;
+static std::mutex metadataCacheLock;
+
+void readLOFARHeader(const std::string &headerFilename, Observation &observation, unsigned int nrBatches, unsigned int firstBatch)
+{
+    setLOFARObservation(getLOFARMetadata(headerFilename), observation, nrBatches, firstBatch);
+}
+
+LOFARMetadata readLOFARMetadata(const std::string &headerFilename)
+{
+    LOFARMetadata metadata;
+    // Read the HDF5 file with the metadata
+    H5::H5File headerFile = H5::H5File(headerFilename, H5F_ACC_RDONLY);
+    H5::FloatType typeDouble = H5::FloatType(H5::PredType::NATIVE_DOUBLE);
+    H5::IntType typeUInt = H5::IntType(H5::PredType::NATIVE_UINT);
+    std::vector<std::string> beamNames;
+
+    H5::Group root = headerFile.openGroup("/");
+    root.openAttribute("OBSERVATION_FREQUENCY_MIN").read(typeDouble, reinterpret_cast<void *>(&metadata.minFreq));
+    for ( hsize_t object = 0; object < root.getNumObjs(); object++ )
     {
-        throw FileError("ERROR: impossible to open SIGPROC file \"" + inputFilename + "\".");
+        std::string name = root.getObjnameByIdx(object);
+
+        if ( (name.compare(0, 19, "SUB_ARRAY_POINTING_") == 0) && (metadata.subArrayPointing.empty() || (name < metadata.subArrayPointing)) )
+        {
+            metadata.subArrayPointing = name;
+        }
+    }
+    if ( metadata.subArrayPointing.empty() )
+    {
+        throw FileError("ERROR: no sub-array pointing in LOFAR file \"" + headerFilename + "\".");
     }
-    while ( inputFile.get(buffer) )
+    H5::Group subArrayPointing = root.openGroup(metadata.subArrayPointing);
+    subArrayPointing.openAttribute("TOTAL_INTEGRATION_TIME").read(typeDouble, reinterpret_cast<void *>(&metadata.totalIntegrationTime));
+    subArrayPointing.openAttribute("NOF_BEAMS").read(typeUInt, reinterpret_cast<void *>(&metadata.nrBeams));
+    for ( hsize_t object = 0; object < subArrayPointing.getNumObjs(); object++ )
     {
-        switch ( buffer )
+        std::string name = subArrayPointing.getObjnameByIdx(object);
+
+        if ( name.compare(0, 5, "BEAM_") == 0 )
         {
-            case 't':
-                if ( state == 0 )
-                {
-                    state = 1;
-                }
-                break;
-            case 's':
-                if ( (state == 1) || (state == 5) )
-                {
-                    state++;
-                }
-                else if ( state == 11 )
-                {
-                    // nsamples : int
-                    inputFile.read(temp32, 4);
-                    nsamples = *(reinterpret_cast<unsigned int *>(temp32));
-                    bytesRead += 4;
-                    state = 0;
-                }
-                else if ( state == 20 )
-                {
-                    // nchans : int
-                    inputFile.read(temp32, 4);
-                    nchans = *(reinterpret_cast<unsigned int *>(temp32));
-                    bytesRead += 4;
-                    state = 0;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'a':
-                if ( (state == 2) || (state == 6) || (state == 18) )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'm':
-                if ( (state == 3) || (state == 7) )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'p':
-                if ( state == 4 )
-                {
-                    // tsamp : double
-                    inputFile.read(temp64, 8);
-                    tsamp = *(reinterpret_cast<double *>(temp64));
-                    bytesRead += 8;
-                    state = 0;
-                }
-                else if ( state == 8 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'n':
-                if ( state == 0 )
-                {
-                    state = 5;
-                }
-                else if ( state == 19 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'l':
-                if ( state == 9 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'e':
-                if ( state == 10 )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'f':
-                if ( state == 0 )
-                {
-                    state = 12;
-                }
-                else if ( state == 15 )
-                {
-                    state++;
-                }
-                else if ( state == 16 )
-                {
-                    // foff : double
-                    inputFile.read(temp64, 8);
-                    foff = *(reinterpret_cast<double *>(temp64));
-                    bytesRead += 8;
-                    state = 0;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'c':
-                if ( state == 12 )
-                {
-                    state++;
-                }
-                else if ( state == 5 )
-                {
-                    state = 17;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'h':
-                if ( (state == 13) || (state == 17) )
-                {
-                    state++;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case '1':
-                if ( state == 14 )
-                {
-                    // fch1 : double
-                    inputFile.read(temp64, 8);
-                    fch1 = *(reinterpret_cast<double *>(temp64));
-                    bytesRead += 8;
-                    state = 0;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            case 'o':
-                if ( state == 12 )
-                {
-                    state = 15;
-                }
-                else
-                {
-                    state = 0;
-                }
-                break;
-            default:
-                state = 0;
-                break;
+            beamNames.push_back(name);
         }
-        bytesRead++;
-        if ( bytesRead >= headerSize )
+    }
+    if ( beamNames.empty() )
+    {
+        throw FileError("ERROR: no beams in LOFAR file \"" + headerFilename + "\".");
+    }
+    std::sort(beamNames.begin(), beamNames.end());
+    for ( const auto &name : beamNames )
+    {
+        LOFARBeam beam;
+        double channelWidth = 0.0;
+        H5::Group beamGroup = subArrayPointing.openGroup(name);
+
+        beam.name = name;
+        beamGroup.openAttribute("NOF_SAMPLES").read(typeUInt, reinterpret_cast<void *>(&beam.nrSamples));
+        beamGroup.openAttribute("NOF_STATIONS").read(typeUInt, reinterpret_cast<void *>(&beam.nrStations));
+        beamGroup.openAttribute("CHANNELS_PER_SUBBAND").read(typeUInt, reinterpret_cast<void *>(&beam.nrChannelsPerSubband));
+        beamGroup.openAttribute("CHANNEL_WIDTH").read(typeDouble, reinterpret_cast<void *>(&channelWidth));
+        beam.channelBandwidth = channelWidth / 1000000;
+        beamGroup.openDataSet("STOKES_0").openAttribute("NOF_SUBBANDS").read(typeUInt, reinterpret_cast<void *>(&beam.nrSubbands));
+        metadata.beams.push_back(beam);
+    }
+    headerFile.close();
+    return metadata;
+}
+
+LOFARMetadata getLOFARMetadata(const std::string &headerFilename)
+{
+    {
+        std::lock_guard<std::mutex> guard(metadataCacheLock);
+        auto metadata = metadataCache.find(headerFilename);
+
+        if ( metadata != metadataCache.end() )
         {
-            break;
+            return metadata->second;
+        }
+    }
+    LOFARMetadata metadata = readLOFARMetadata(headerFilename);
+    std::lock_guard<std::mutex> guard(metadataCacheLock);
+    metadataCache[headerFilename] = metadata;
+    return metadata;
+}
+
+void clearLOFARMetadataCache()
+{
+    std::lock_guard<std::mutex> guard(metadataCacheLock);
+    metadataCache.clear();
+}
+#endif // HAVE_HDF5
+
+LOFARBeam::LOFARBeam() : nrSamples(0), nrStations(0), nrChannelsPerSubband(0), channelBandwidth(0.0f), nrSubbands(0) {}
+
+LOFARMetadata::LOFARMetadata() : minFreq(0.0), totalIntegrationTime(0.0), nrBeams(0) {}
+
+void setLOFARObservation(const LOFARMetadata &metadata, Observation &observation, const unsigned int nrBatches, const unsigned int firstBatch, const unsigned int beam)
+{
+    const LOFARBeam &beamMetadata = metadata.beams.at(beam);
+    const unsigned int totalBatches = static_cast<unsigned int>(metadata.totalIntegrationTime);
+
+    observation.setNrBeams(metadata.nrBeams);
+    observation.setNrStations(beamMetadata.nrStations);
+    observation.setNrSamplesPerBatch(static_cast<unsigned int>(beamMetadata.nrSamples / metadata.totalIntegrationTime));
+    if ( nrBatches == 0 )
+    {
+        observation.setNrBatches(totalBatches);
+    }
+    else if ( totalBatches >= (firstBatch + nrBatches) )
+    {
+        observation.setNrBatches(nrBatches);
+    }
+    else
+    {
+        observation.setNrBatches(totalBatches - firstBatch);
+    }
+    observation.setFrequencyRange(1, beamMetadata.nrSubbands * beamMetadata.nrChannelsPerSubband, metadata.minFreq, beamMetadata.channelBandwidth);
+}
+
+void checkLOFARBeams(const LOFARMetadata &metadata, const std::vector<std::vector<std::string>> &rawFilenames)
+{
+    if ( metadata.beams.empty() || (rawFilenames.size() != metadata.beams.size()) || (metadata.nrBeams != metadata.beams.size()) )
+    {
+        throw FileError("ERROR: " + std::to_string(rawFilenames.size()) + " beams of raw files for " + std::to_string(metadata.beams.size()) + " LOFAR beams.");
+    }
+    for ( unsigned int beam = 1; beam < metadata.beams.size(); beam++ )
+    {
+        const LOFARBeam &first = metadata.beams.at(0);
+        const LOFARBeam &other = metadata.beams.at(beam);
+
+        if ( (other.nrSamples != first.nrSamples) || (other.nrSubbands != first.nrSubbands) || (other.nrChannelsPerSubband != first.nrChannelsPerSubband) || (other.channelBandwidth != first.channelBandwidth) )
+        {
+            throw FileError("ERROR: the parameters of LOFAR beam " + std::to_string(beam) + " differ from the ones of beam 0.");
         }
     }
-    inputFile.close();
-    observation.setNrSamplesPerBatch(nsamples / observation.getNrBatches());
-    observation.setSamplingTime(tsamp);
-    observation.setFrequencyRange(subbands, nchans, fch1 + (foff * (nchans - 1)), -foff);
 }
 
 #ifdef HAVE_PSRDADA
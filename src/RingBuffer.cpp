@@ -0,0 +1,159 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <RingBuffer.hpp>
+
+#include <sstream>
+#include <thread>
+
+namespace AstroData
+{
+
+RingBuffer::RingBuffer(const unsigned int nrBlocks, const std::size_t blockSize, const unsigned int nrConsumers, const unsigned int padding) : blocks(nrBlocks, blockSize, padding), blockBytes(new std::atomic<std::size_t>[nrBlocks]), headerWritten(false), nrRead(new Counter[nrConsumers]), nrBlocks(nrBlocks), blockSize(blockSize), nrConsumers(nrConsumers)
+{
+    if ((nrBlocks == 0) || (nrConsumers == 0))
+    {
+        throw RingBufferError("ERROR: a ring buffer needs at least one block and one consumer.");
+    }
+    nrWritten.value = 0;
+    endOfData.value = 0;
+    for (unsigned int block = 0; block < nrBlocks; block++)
+    {
+        blockBytes[block] = 0;
+    }
+    for (unsigned int consumer = 0; consumer < nrConsumers; consumer++)
+    {
+        nrRead[consumer].value = 0;
+    }
+}
+
+void RingBuffer::setHeader(const std::string &header)
+{
+    if (headerWritten.load(std::memory_order_acquire))
+    {
+        throw RingBufferError("ERROR: the ring buffer header can be written only once.");
+    }
+    this->header = header;
+    headerWritten.store(true, std::memory_order_release);
+}
+
+const std::string &RingBuffer::getHeader() const
+{
+    while (!headerWritten.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+    return header;
+}
+
+char *RingBuffer::getNextWrite()
+{
+    const std::uint64_t block = nrWritten.value.load(std::memory_order_relaxed);
+
+    // The block is free when the slowest consumer has cleared its previous use
+    for (unsigned int consumer = 0; consumer < nrConsumers; consumer++)
+    {
+        while (block - nrRead[consumer].value.load(std::memory_order_acquire) >= nrBlocks)
+        {
+            std::this_thread::yield();
+        }
+    }
+    return blocks.getSlot(block % nrBlocks);
+}
+
+void RingBuffer::markFilled(const std::size_t bytes)
+{
+    const std::uint64_t block = nrWritten.value.load(std::memory_order_relaxed);
+
+    if (bytes > blockSize)
+    {
+        throw RingBufferError("ERROR: more bytes than the size of a ring buffer block.");
+    }
+    blockBytes[block % nrBlocks].store(bytes, std::memory_order_relaxed);
+    nrWritten.value.store(block + 1, std::memory_order_release);
+}
+
+void RingBuffer::markEndOfData()
+{
+    endOfData.value.store(1, std::memory_order_release);
+}
+
+const char *RingBuffer::getNextRead(const unsigned int consumer, std::size_t &bytes)
+{
+    const std::uint64_t block = nrRead[consumer].value.load(std::memory_order_relaxed);
+
+    while (nrWritten.value.load(std::memory_order_acquire) <= block)
+    {
+        // The end of data is checked before the counter again, as blocks may have been written just before it
+        if (endOfData.value.load(std::memory_order_acquire) != 0 && nrWritten.value.load(std::memory_order_acquire) <= block)
+        {
+            bytes = 0;
+            return nullptr;
+        }
+        std::this_thread::yield();
+    }
+    bytes = blockBytes[block % nrBlocks].load(std::memory_order_relaxed);
+    return blocks.getSlot(block % nrBlocks);
+}
+
+void RingBuffer::markCleared(const unsigned int consumer)
+{
+    nrRead[consumer].value.fetch_add(1, std::memory_order_release);
+}
+
+void readRingBufferHeader(Observation &observation, const RingBuffer &ringBuffer)
+{
+    std::istringstream header(ringBuffer.getHeader());
+    std::string line;
+    unsigned int nrChannels = 0;
+    float minFreq = 0.0f;
+    float channelBandwidth = 0.0f;
+
+    while (std::getline(header, line))
+    {
+        std::istringstream keyValue(line);
+        std::string key;
+
+        keyValue >> key;
+        if (key == "SAMPLES_PER_BATCH")
+        {
+            unsigned int samples = 0;
+
+            keyValue >> samples;
+            observation.setNrSamplesPerBatch(samples);
+        }
+        else if (key == "NCHAN")
+        {
+            keyValue >> nrChannels;
+        }
+        else if (key == "MIN_FREQUENCY")
+        {
+            keyValue >> minFreq;
+        }
+        else if (key == "CHANNEL_BANDWIDTH")
+        {
+            keyValue >> channelBandwidth;
+        }
+        else if (key == "TSAMP")
+        {
+            float samplingTime = 0.0f;
+
+            keyValue >> samplingTime;
+            observation.setSamplingTime(samplingTime);
+        }
+    }
+    observation.setFrequencyRange(observation.getNrSubbands(), nrChannels, minFreq, channelBandwidth);
+}
+
+} // namespace AstroData
@@ -0,0 +1,115 @@
+// Copyright 2017 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <WriteData.hpp>
+
+namespace AstroData
+{
+
+void setSIGPROCHeader(const Observation &observation, const uint8_t outputBits, SIGPROCHeader &header)
+{
+    header.nbits = outputBits;
+    header.nifs = 1;
+    header.nchans = observation.getNrChannels();
+    header.tsamp = observation.getSamplingTime();
+    // SIGPROC files start from the highest frequency channel
+    header.fch1 = observation.getMinFreq() + (observation.getChannelBandwidth() * (observation.getNrChannels() - 1));
+    header.foff = -observation.getChannelBandwidth();
+}
+
+void writeSIGPROCHeader(const SIGPROCHeader &header, std::ostream &outputFile)
+{
+    auto writeString = [&outputFile](const std::string &value) {
+        std::int32_t length = value.size();
+
+        outputFile.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        outputFile.write(value.data(), length);
+    };
+    auto writeInteger = [&](const std::string &keyword, const std::int32_t value) {
+        writeString(keyword);
+        outputFile.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    auto writeDouble = [&](const std::string &keyword, const double value) {
+        writeString(keyword);
+        outputFile.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+
+    writeString("HEADER_START");
+    if ( !header.sourceName.empty() )
+    {
+        writeString("source_name");
+        writeString(header.sourceName);
+    }
+    if ( !header.rawDataFile.empty() )
+    {
+        writeString("rawdatafile");
+        writeString(header.rawDataFile);
+    }
+    writeInteger("telescope_id", header.telescopeID);
+    writeInteger("machine_id", header.machineID);
+    writeInteger("data_type", header.dataType);
+    writeInteger("barycentric", header.barycentric);
+    writeInteger("pulsarcentric", header.pulsarcentric);
+    writeDouble("src_raj", header.srcRaj);
+    writeDouble("src_dej", header.srcDej);
+    writeDouble("az_start", header.azStart);
+    writeDouble("za_start", header.zaStart);
+    writeInteger("nbits", header.nbits);
+    writeInteger("nifs", header.nifs);
+    writeInteger("nchans", header.nchans);
+    if ( header.nbeams > 0 )
+    {
+        writeInteger("nbeams", header.nbeams);
+        writeInteger("ibeam", header.ibeam);
+    }
+    if ( header.nsamples > 0 )
+    {
+        writeInteger("nsamples", header.nsamples);
+    }
+    writeDouble("tstart", header.tstart);
+    writeDouble("tsamp", header.tsamp);
+    writeDouble("fch1", header.fch1);
+    writeDouble("foff", header.foff);
+    if ( header.refdm != 0.0 )
+    {
+        writeDouble("refdm", header.refdm);
+    }
+    if ( header.period != 0.0 )
+    {
+        writeDouble("period", header.period);
+    }
+    writeString("HEADER_END");
+}
+
+void writeFileAt(const int fileDescriptor, const void *buffer, const std::uint64_t size, const std::uint64_t offset)
+{
+    std::uint64_t bytesWritten = 0;
+
+    while ( bytesWritten < size )
+    {
+        ssize_t result = pwrite(fileDescriptor, reinterpret_cast<const char *>(buffer) + bytesWritten, size - bytesWritten, offset + bytesWritten);
+
+        if ( result < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( result <= 0 )
+        {
+            throw FileError("ERROR: impossible to write " + std::to_string(size) + " bytes at offset " + std::to_string(offset) + ".");
+        }
+        bytesWritten += result;
+    }
+}
+
+} // namespace AstroData
@@ -0,0 +1,167 @@
+// Copyright 2019 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <BatchFile.hpp>
+#include <ArgumentList.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <gtest/gtest.h>
+
+std::string path;
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    isa::utils::ArgumentList arguments(argc, argv);
+    try
+    {
+        path = arguments.getSwitchArgument<std::string>("-path");
+    }
+    catch ( std::exception &err )
+    {
+        std::cerr << std::endl;
+        std::cerr << "Required command line parameters:" << std::endl;
+        std::cerr << "\t-path <string> // The path of the test input files" << std::endl;
+        std::cerr << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+TEST(BatchFile, FileError)
+{
+    EXPECT_THROW(AstroData::BatchFile("does_not_exist"), AstroData::FileError);
+    EXPECT_THROW(AstroData::BatchFile(path + "/zapped_channels.conf"), AstroData::FileError);
+    // A corrupted number of batches is rejected without allocating the index
+    const std::string filename = testing::TempDir() + "corrupted.adb";
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> batch;
+    std::uint32_t nrBatches = 0xffffffff;
+
+    observation.setFrequencyRange(1, 16, 1400.0f, 1.0f);
+    observation.setNrSamplesPerBatch(64);
+    batch.resize(AstroData::getPaddedBatchSize<std::uint8_t>(observation, 64, 8));
+    {
+        AstroData::BatchFileWriter<std::uint8_t> writer(observation, 64, 8, filename);
+
+        writer.write(batch.data());
+    }
+    EXPECT_NO_THROW(AstroData::BatchFile{filename});
+    {
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+
+        file.seekp(24);
+        file.write(reinterpret_cast<const char *>(&nrBatches), sizeof(nrBatches));
+    }
+    EXPECT_THROW(AstroData::BatchFile{filename}, AstroData::FileError);
+}
+
+TEST(BatchFile, Encodings)
+{
+    std::vector<std::uint8_t> input(4096);
+    std::vector<std::uint8_t> planes(input.size());
+    std::vector<std::uint8_t> encoded(input.size() * 2);
+    std::vector<std::uint8_t> output(input.size());
+    std::mt19937 generator(7);
+
+    for ( std::uint64_t item = 0; item < input.size(); item++ )
+    {
+        input.at(item) = (item % 3 == 0) ? generator() : 42;
+    }
+    AstroData::bitshuffle(input.data(), planes.data(), 4, input.size() / 4);
+    AstroData::bitunshuffle(planes.data(), output.data(), 4, input.size() / 4);
+    EXPECT_EQ(output, input);
+    std::uint64_t encodedSize = AstroData::encodeRLE(input.data(), input.size(), encoded.data(), encoded.size());
+    ASSERT_GT(encodedSize, 0);
+    AstroData::decodeRLE(encoded.data(), encodedSize, output.data(), output.size());
+    EXPECT_EQ(output, input);
+    EXPECT_EQ(AstroData::encodeRLE(input.data(), input.size(), encoded.data(), 16), 0);
+    EXPECT_THROW(AstroData::decodeRLE(encoded.data(), encodedSize, output.data(), output.size() - 1), AstroData::FileError);
+}
+
+TEST(BatchFile, RandomAccess)
+{
+    const unsigned int padding = 64;
+    const std::string filename = testing::TempDir() + "batches.adb";
+    AstroData::Observation observation;
+    std::vector<std::vector<std::uint16_t>> batches(5);
+    std::vector<std::uint16_t> batch;
+    std::mt19937 generator(11);
+
+    observation.setFrequencyRange(4, 100, 1300.0f, 0.25f);
+    observation.setNrSamplesPerBatch(1000);
+    observation.setSamplingTime(0.000064f);
+    observation.setDMRange(256, 2.0f, 0.5f);
+    observation.setNrDelayBatches(2);
+    const std::uint64_t nrItems = AstroData::getPaddedBatchSize<std::uint16_t>(observation, padding, 16);
+    // Even batches compress well, odd batches are noise
+    for ( unsigned int batchIndex = 0; batchIndex < batches.size(); batchIndex++ )
+    {
+        batches.at(batchIndex).resize(nrItems);
+        for ( std::uint64_t item = 0; item < nrItems; item++ )
+        {
+            batches.at(batchIndex).at(item) = (batchIndex % 2 == 0) ? 1000 + (item % 100 == 0) : generator();
+        }
+    }
+    for ( auto encoding : {AstroData::BatchEncoding::Raw, AstroData::BatchEncoding::BitshuffleRLE} )
+    {
+        {
+            AstroData::BatchFileWriter<std::uint16_t> writer(observation, padding, 16, filename, encoding);
+
+            for ( auto &batchData : batches )
+            {
+                writer.write(batchData);
+            }
+            EXPECT_EQ(writer.getNrBatches(), batches.size());
+        }
+        AstroData::BatchFile file(filename);
+        EXPECT_EQ(file.getNrBatches(), batches.size());
+        EXPECT_EQ(file.getObservation().getNrBatches(), batches.size());
+        EXPECT_EQ(file.getObservation().getNrChannels(), observation.getNrChannels());
+        EXPECT_EQ(file.getObservation().getNrSubbands(), observation.getNrSubbands());
+        EXPECT_EQ(file.getObservation().getNrSamplesPerBatch(), observation.getNrSamplesPerBatch());
+        EXPECT_EQ(file.getObservation().getNrDMs(), observation.getNrDMs());
+        EXPECT_EQ(file.getObservation().getNrDelayBatches(), observation.getNrDelayBatches());
+        EXPECT_FLOAT_EQ(file.getObservation().getMinFreq(), observation.getMinFreq());
+        EXPECT_FLOAT_EQ(file.getObservation().getSamplingTime(), observation.getSamplingTime());
+        EXPECT_EQ(file.getPadding(), padding);
+        EXPECT_EQ(file.getBatchSize(), nrItems * sizeof(std::uint16_t));
+        EXPECT_THROW(file.getBatch<float>(0), AstroData::FileError);
+        batch.resize(nrItems);
+        for ( unsigned int batchIndex : {3u, 0u, 4u, 1u, 2u} )
+        {
+            const AstroData::BatchFileEntry &entry = file.getEntry(batchIndex);
+
+            EXPECT_EQ(entry.offset % AstroData::batchFileAlignment, 0);
+            file.readBatch(batchIndex, batch.data());
+            EXPECT_EQ(batch, batches.at(batchIndex));
+            if ( (encoding == AstroData::BatchEncoding::BitshuffleRLE) && (batchIndex % 2 == 0) )
+            {
+                EXPECT_EQ(entry.encoding, AstroData::BatchEncoding::BitshuffleRLE);
+                EXPECT_LT(entry.size, file.getBatchSize() / 10);
+                EXPECT_THROW(file.getBatch<std::uint16_t>(batchIndex), AstroData::FileError);
+            }
+            else
+            {
+                EXPECT_EQ(entry.encoding, AstroData::BatchEncoding::Raw);
+                const std::uint16_t *view = file.getBatch<std::uint16_t>(batchIndex);
+                EXPECT_TRUE(std::equal(batches.at(batchIndex).begin(), batches.at(batchIndex).end(), view));
+            }
+        }
+        EXPECT_THROW(file.getEntry(batches.size()), AstroData::FileError);
+    }
+}
@@ -0,0 +1,318 @@
+// Copyright 2019 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Generator.hpp>
+#include <SyntheticStream.hpp>
+#include <ArgumentList.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+std::string path;
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    isa::utils::ArgumentList arguments(argc, argv);
+    try
+    {
+        path = arguments.getSwitchArgument<std::string>("-path");
+    }
+    catch ( std::exception &err )
+    {
+        std::cerr << std::endl;
+        std::cerr << "Required command line parameters:" << std::endl;
+        std::cerr << "\t-path <string> // The path of the test input files" << std::endl;
+        std::cerr << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+AstroData::Observation getObservation()
+{
+    AstroData::Observation observation;
+
+    observation.setNrBatches(4);
+    observation.setNrSamplesPerBatch(1000);
+    observation.setSamplingTime(0.001f);
+    observation.setFrequencyRange(1, 64, 1400.0f, 0.5f);
+    return observation;
+}
+
+TEST(Generator, Pulsar)
+{
+    AstroData::Observation observation = getObservation();
+    AstroData::BatchArena<std::uint8_t> serial;
+    AstroData::BatchArena<std::uint8_t> parallel;
+    AstroData::BatchArena<std::uint8_t> otherSeed;
+
+    AstroData::generatePulsar(100, 5, 10.0f, observation, 64, serial, true, 42, 1);
+    AstroData::generatePulsar(100, 5, 10.0f, observation, 64, parallel, true, 42, 4);
+    AstroData::generatePulsar(100, 5, 10.0f, observation, 64, otherSeed, true, 43, 4);
+    bool different = false;
+
+    for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+    {
+        for ( std::uint64_t item = 0; item < serial.getSlotSize(); item++ )
+        {
+            ASSERT_EQ(serial.getSlot(batch)[item], parallel.getSlot(batch)[item]);
+            different |= serial.getSlot(batch)[item] != otherSeed.getSlot(batch)[item];
+        }
+    }
+    EXPECT_TRUE(different);
+}
+
+TEST(Generator, SinglePulse)
+{
+    AstroData::Observation observation = getObservation();
+
+    for ( std::uint8_t inputBits : {1, 2, 4, 8} )
+    {
+        AstroData::BatchArena<std::uint8_t> serial;
+        AstroData::BatchArena<std::uint8_t> parallel;
+        AstroData::BatchArena<std::uint8_t> otherSeed;
+
+        AstroData::generateSinglePulse(10, 10.0f, observation, 64, serial, inputBits, true, 42, 1);
+        AstroData::generateSinglePulse(10, 10.0f, observation, 64, parallel, inputBits, true, 42, 4);
+        AstroData::generateSinglePulse(10, 10.0f, observation, 64, otherSeed, inputBits, true, 43, 4);
+        bool different = false;
+
+        for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+        {
+            for ( std::uint64_t item = 0; item < serial.getSlotSize(); item++ )
+            {
+                ASSERT_EQ(serial.getSlot(batch)[item], parallel.getSlot(batch)[item]);
+                different |= serial.getSlot(batch)[item] != otherSeed.getSlot(batch)[item];
+            }
+        }
+        EXPECT_TRUE(different);
+    }
+}
+
+TEST(Generator, PackedSinglePulse)
+{
+    AstroData::Observation observation = getObservation();
+    std::shared_ptr<const std::vector<float>> channelDelays = observation.getChannelDelays();
+
+    for ( std::uint8_t inputBits : {1, 2, 4} )
+    {
+        const unsigned int itemsPerByte = 8 / inputBits;
+        AstroData::BatchArena<std::uint8_t> constant;
+        AstroData::BatchArena<std::uint8_t> noise;
+
+        AstroData::generateSinglePulse(13, 10.0f, observation, 64, constant, inputBits, false, 0, 4);
+        AstroData::generateSinglePulse(13, 10.0f, observation, 64, noise, inputBits, true, 42, 4);
+        const std::uint64_t nrRowItems = constant.getSlotSize() / observation.getNrChannels();
+
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            const std::uint64_t first = (2 * observation.getNrSamplesPerBatch()) + (observation.getNrSamplesPerBatch() / 2) + static_cast<unsigned int>(channelDelays->at(channel) * 10.0f * observation.getNrSamplesPerBatch());
+            unsigned int nrNoiseItems = 0;
+            unsigned int nrPulseItems = 0;
+
+            for ( std::uint64_t sample = 0; sample < observation.getNrBatches() * observation.getNrSamplesPerBatch(); sample++ )
+            {
+                const unsigned int batch = sample / observation.getNrSamplesPerBatch();
+                const unsigned int internalSample = sample % observation.getNrSamplesPerBatch();
+                const unsigned int firstBit = (internalSample % itemsPerByte) * inputBits;
+                const std::uint8_t constantItem = (constant.getSlot(batch)[(channel * nrRowItems) + (internalSample / itemsPerByte)] >> firstBit) & ((1 << inputBits) - 1);
+                const std::uint8_t noiseItem = (noise.getSlot(batch)[(channel * nrRowItems) + (internalSample / itemsPerByte)] >> firstBit) & ((1 << inputBits) - 1);
+
+                if ( (sample >= first) && (sample < first + 13) )
+                {
+                    ASSERT_EQ(constantItem, inputBits & ((1 << inputBits) - 1));
+                }
+                else
+                {
+                    ASSERT_EQ(constantItem, 0);
+                }
+                // Noise uses only the lower half of the range of values, so only the random pulse can be above it
+                nrPulseItems += noiseItem >= (1 << (inputBits - 1));
+                nrNoiseItems += (noiseItem > 0) && (noiseItem < (1 << (inputBits - 1)));
+            }
+            EXPECT_LE(nrPulseItems, 13u);
+            if ( inputBits > 1 )
+            {
+                EXPECT_GT(nrNoiseItems, 0u);
+            }
+        }
+    }
+}
+
+TEST(Generator, InjectPulses)
+{
+    AstroData::Observation observation = getObservation();
+    std::vector<AstroData::SyntheticPulse> pulses(4);
+
+    // There are no delays without a sampling time
+    EXPECT_EQ(AstroData::getPulseDelay(1.0f, 10.0f, AstroData::Observation()), 0u);
+    // Batches are two seconds long
+    observation.setSamplingTime(0.002f);
+    pulses.at(0).DM = 500.0f;
+    pulses.at(0).sample = 1950;
+    pulses.at(0).width = 20;
+    pulses.at(0).fluence = 60.0f;
+    // Before the loaded batches
+    pulses.at(1).sample = 500;
+    pulses.at(1).width = 4;
+    pulses.at(1).fluence = 4000.0f;
+    // Outside of the loaded batches
+    pulses.at(2).sample = 100000;
+    pulses.at(2).fluence = 100.0f;
+    // Periodic, starting before the loaded batches
+    pulses.at(3).sample = 200;
+    pulses.at(3).width = 2;
+    pulses.at(3).period = 300;
+    pulses.at(3).fluence = 2.0f;
+
+    for ( std::uint8_t inputBits : {2, 8} )
+    {
+        const std::uint64_t nrRowItems = (inputBits >= 8) ? observation.getNrSamplesPerBatch(false, 64) : isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), 64);
+        const unsigned int baseline = (inputBits >= 8) ? 8 : 1;
+        const unsigned int maxValue = (1 << inputBits) - 1;
+        // Only batches 1 and 2 of the observation are loaded
+        std::vector<std::vector<std::uint8_t>> batches(2, std::vector<std::uint8_t>(observation.getNrChannels() * nrRowItems, (inputBits >= 8) ? baseline : 0x55));
+        std::vector<std::uint8_t *> data = {batches.at(0).data(), batches.at(1).data()};
+
+        AstroData::injectPulses(pulses, observation, 64, data, inputBits, 1, 4);
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            const double maxFreq = observation.getMaxFreq();
+            const double frequency = observation.getMinFreq() + (channel * observation.getChannelBandwidth());
+            const std::uint64_t delay = 4148.808 * 500.0 * ((1.0 / (frequency * frequency)) - (1.0 / (maxFreq * maxFreq))) / observation.getSamplingTime();
+
+            for ( std::uint64_t sample = 1000; sample < 3000; sample++ )
+            {
+                const unsigned int internalSample = sample % observation.getNrSamplesPerBatch();
+                const unsigned int item = (inputBits >= 8) ? internalSample : internalSample / (8 / inputBits);
+                const std::uint8_t byte = batches.at((sample / observation.getNrSamplesPerBatch()) - 1).at((channel * nrRowItems) + item);
+                unsigned int value = byte;
+                unsigned int expected = baseline;
+
+                if ( inputBits < 8 )
+                {
+                    value = (byte >> ((internalSample % (8 / inputBits)) * inputBits)) & maxValue;
+                }
+                if ( (sample >= 1950 + delay) && (sample < 1970 + delay) )
+                {
+                    expected += 3;
+                }
+                if ( (sample - 200) % 300 < 2 )
+                {
+                    expected += 1;
+                }
+                ASSERT_EQ(value, std::min(expected, maxValue));
+            }
+        }
+    }
+}
+
+TEST(SyntheticStream, Pulses)
+{
+    AstroData::Observation observation = getObservation();
+    std::vector<AstroData::SyntheticPulse> pulses(2);
+
+    observation.setNrBeams(2);
+    pulses.at(0).beam = 1;
+    pulses.at(0).DM = 10.0f;
+    pulses.at(0).sample = 900;
+    pulses.at(0).width = 200;
+    pulses.at(0).fluence = 42.0f * 200;
+    pulses.at(1).sample = 10;
+    pulses.at(1).width = 2;
+    pulses.at(1).period = 700;
+    pulses.at(1).fluence = 42.0f * 2;
+    AstroData::SyntheticStream<std::uint8_t> stream(observation, 64, pulses, AstroData::StreamPacing::OnDemand, 8.0f, 0);
+    std::vector<std::uint8_t> data;
+    const std::uint64_t nrPaddedSamples = observation.getNrSamplesPerBatch(false, 64);
+    const double maxFreq = observation.getMaxFreq();
+
+    for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+    {
+        ASSERT_TRUE(stream.next(&data));
+        ASSERT_EQ(data.size(), 2 * stream.getBatchSize());
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            const double frequency = observation.getMinFreq() + (channel * observation.getChannelBandwidth());
+            const std::uint64_t delay = 4148.808 * 10.0 * ((1.0 / (frequency * frequency)) - (1.0 / (maxFreq * maxFreq))) / observation.getSamplingTime();
+
+            for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+            {
+                const std::uint64_t streamSample = (batch * observation.getNrSamplesPerBatch()) + sample;
+                const bool periodic = (streamSample >= 10) && ((streamSample - 10) % 700 < 2);
+                const bool single = (streamSample >= 900 + delay) && (streamSample < 1100 + delay);
+
+                EXPECT_EQ(data.at((channel * nrPaddedSamples) + sample), periodic ? 50 : 8);
+                EXPECT_EQ(data.at(stream.getBatchSize() + (channel * nrPaddedSamples) + sample), single ? 50 : 8);
+            }
+        }
+    }
+    EXPECT_FALSE(stream.next(&data));
+    EXPECT_EQ(stream.getBatch(), observation.getNrBatches());
+}
+
+TEST(SyntheticStream, Noise)
+{
+    AstroData::Observation observation = getObservation();
+
+    observation.setNrBeams(3);
+    AstroData::SyntheticStream<std::uint8_t> serial(observation, 64, std::vector<AstroData::SyntheticPulse>(), AstroData::StreamPacing::OnDemand, 0.0f, 25, 42, 1);
+    AstroData::SyntheticStream<std::uint8_t> parallel(observation, 64, std::vector<AstroData::SyntheticPulse>(), AstroData::StreamPacing::OnDemand, 0.0f, 25, 42, 4);
+    std::vector<std::uint8_t> serialData;
+    std::vector<std::uint8_t> parallelData;
+
+    while ( serial.next(&serialData) )
+    {
+        ASSERT_TRUE(parallel.next(&parallelData));
+        ASSERT_EQ(serialData, parallelData);
+        for ( auto value : serialData )
+        {
+            ASSERT_LT(value, 25);
+        }
+    }
+    EXPECT_FALSE(parallel.next(&parallelData));
+    EXPECT_GT(serial.getThroughput(), 0.0);
+    // The stream keeps its own copy of the observation, so it can be built from a temporary
+    AstroData::SyntheticStream<std::uint8_t> reference(observation, 64, std::vector<AstroData::SyntheticPulse>(), AstroData::StreamPacing::OnDemand, 0.0f, 25, 42, 1);
+    AstroData::SyntheticStream<std::uint8_t> temporary(AstroData::Observation(observation), 64, std::vector<AstroData::SyntheticPulse>(), AstroData::StreamPacing::OnDemand, 0.0f, 25, 42, 1);
+    std::vector<std::uint8_t> temporaryData;
+
+    while ( reference.next(&serialData) )
+    {
+        ASSERT_TRUE(temporary.next(&temporaryData));
+        ASSERT_EQ(serialData, temporaryData);
+    }
+    EXPECT_FALSE(temporary.next(&temporaryData));
+}
+
+TEST(SyntheticStream, RealTime)
+{
+    AstroData::Observation observation = getObservation();
+
+    observation.setNrBeams(1);
+    observation.setSamplingTime(0.00001f);
+    AstroData::SyntheticStream<float> stream(observation, 64, std::vector<AstroData::SyntheticPulse>(), AstroData::StreamPacing::RealTime);
+    std::vector<float> data;
+    auto start = std::chrono::steady_clock::now();
+
+    while ( stream.next(&data) )
+    {
+    }
+    // Four batches of 10 ms
+    EXPECT_GE(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0.04 * 0.99);
+    EXPECT_LE(stream.getThroughput(), 1.0 / 0.00001 * 1.01);
+}
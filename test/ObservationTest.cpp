@@ -0,0 +1,114 @@
+// Copyright 2019 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Observation.hpp>
+#include <ArgumentList.hpp>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+std::string path;
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    isa::utils::ArgumentList arguments(argc, argv);
+    try
+    {
+        path = arguments.getSwitchArgument<std::string>("-path");
+    }
+    catch ( std::exception &err )
+    {
+        std::cerr << std::endl;
+        std::cerr << "Required command line parameters:" << std::endl;
+        std::cerr << "\t-path <string> // The path of the test input files" << std::endl;
+        std::cerr << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+TEST(Observation, Delays)
+{
+    AstroData::Observation observation;
+
+    observation.setNrSamplesPerBatch(20000);
+    observation.setNrSamplesPerBatch(10000, true);
+    observation.setSamplingTime(0.0001f);
+    observation.setFrequencyRange(4, 64, 1400.0f, 0.5f);
+    observation.setDMRange(100, 0.0f, 0.5f);
+    observation.setDMRange(10, 2.0f, 5.0f, true);
+    std::shared_ptr<const std::vector<float>> channelDelays = observation.getChannelDelays();
+
+    ASSERT_EQ(channelDelays->size(), observation.getNrChannels());
+    for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+    {
+        const double frequency = observation.getMinFreq() + (channel * observation.getChannelBandwidth());
+        const double maxFreq = observation.getMaxFreq();
+
+        EXPECT_NEAR(channelDelays->at(channel), 4148.808 * ((1.0 / (frequency * frequency)) - (1.0 / (maxFreq * maxFreq))), 1.0e-7);
+    }
+    EXPECT_EQ(channelDelays->back(), 0.0f);
+    for ( bool subbanding : {false, true} )
+    {
+        std::shared_ptr<const std::vector<unsigned int>> delays = observation.getDelays(subbanding, 16);
+        const unsigned int nrDMs = observation.getNrDMs(subbanding, 16);
+
+        ASSERT_EQ(delays->size(), observation.getNrChannels() * nrDMs);
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            for ( unsigned int dm = 0; dm < observation.getNrDMs(subbanding); dm++ )
+            {
+                const double DM = observation.getFirstDM(subbanding) + (dm * observation.getDMStep(subbanding));
+                const double delay = channelDelays->at(channel) * DM / observation.getSamplingTime();
+
+                EXPECT_LE(std::abs(delays->at((channel * nrDMs) + dm) - delay), 1.0);
+            }
+        }
+        // Tables are memoised, and rebuilt when the padding changes
+        EXPECT_EQ(observation.getDelays(subbanding, 16).get(), delays.get());
+        EXPECT_EQ(observation.getDelays(subbanding).get()->size(), observation.getNrChannels() * observation.getNrDMs(subbanding));
+    }
+}
+
+TEST(Observation, DelaysInvalidation)
+{
+    AstroData::Observation observation;
+
+    observation.setNrSamplesPerBatch(1000);
+    observation.setSamplingTime(0.001f);
+    observation.setFrequencyRange(1, 32, 1200.0f, 1.0f);
+    observation.setDMRange(8, 0.0f, 10.0f);
+    std::shared_ptr<const std::vector<unsigned int>> delays = observation.getDelays();
+    std::shared_ptr<const std::vector<float>> channelDelays = observation.getChannelDelays();
+    const unsigned int firstDelay = delays->at(7);
+
+    observation.setDMRange(8, 0.0f, 20.0f);
+    EXPECT_EQ(observation.getChannelDelays().get(), channelDelays.get());
+    EXPECT_NE(observation.getDelays()->at(7), firstDelay);
+    // Tables already returned are not affected by later changes
+    EXPECT_EQ(delays->at(7), firstDelay);
+    // Delays do not depend on the length of a batch
+    observation.setNrSamplesPerBatch(2000);
+    EXPECT_NEAR(observation.getDelays()->at(7), 2 * firstDelay, 2.0);
+    observation.setSamplingTime(0.0005f);
+    EXPECT_NEAR(observation.getDelays()->at(7), 4 * firstDelay, 4.0);
+    observation.setSamplingTime(0.0f);
+    EXPECT_EQ(observation.getDelays()->at(7), 0u);
+    observation.setFrequencyRange(1, 32, 1100.0f, 1.0f);
+    EXPECT_NE(observation.getChannelDelays().get(), channelDelays.get());
+    EXPECT_GT(observation.getChannelDelays()->front(), channelDelays->front());
+}
@@ -13,15 +13,119 @@
 // limitations under the License.
 
 #include <ReadData.hpp>
+#include <Prefetcher.hpp>
+#include <DispersedBatchRing.hpp>
 #include <ArgumentList.hpp>
 #include <iostream>
 #include <string>
 #include <vector>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <dirent.h>
 #include <gtest/gtest.h>
 
 std::string const wrongFileName = "does_not_exist";
 std::string path;
 
+// Write a SIGPROC file with a dummy header and the given data
+void writeTestFile(const std::string &filename, const std::uint64_t headerSize, const std::vector<std::uint8_t> &data)
+{
+    std::ofstream outputFile(filename, std::ios::binary);
+    std::vector<char> header(headerSize, 'x');
+
+    outputFile.write(header.data(), header.size());
+    outputFile.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// Write a SIGPROC string or keyword
+void writeSIGPROCString(std::ofstream &outputFile, const std::string &value)
+{
+    std::int32_t length = value.size();
+
+    outputFile.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    outputFile.write(value.c_str(), length);
+}
+
+// Write a SIGPROC file with a minimal header and the given data
+void writeSIGPROCFile(const std::string &filename, const std::int32_t nchans, const std::int32_t nbits, const std::int32_t nsamples, const std::vector<std::uint8_t> &data, const std::string &sourceName = "")
+{
+    std::ofstream outputFile(filename, std::ios::binary);
+    double tsamp = 0.00004096;
+    double fch1 = 1500.0;
+    double foff = -0.1953125;
+
+    writeSIGPROCString(outputFile, "HEADER_START");
+    if ( !sourceName.empty() )
+    {
+        writeSIGPROCString(outputFile, "source_name");
+        writeSIGPROCString(outputFile, sourceName);
+    }
+    writeSIGPROCString(outputFile, "nchans");
+    outputFile.write(reinterpret_cast<const char *>(&nchans), sizeof(nchans));
+    writeSIGPROCString(outputFile, "nbits");
+    outputFile.write(reinterpret_cast<const char *>(&nbits), sizeof(nbits));
+    writeSIGPROCString(outputFile, "tsamp");
+    outputFile.write(reinterpret_cast<const char *>(&tsamp), sizeof(tsamp));
+    writeSIGPROCString(outputFile, "fch1");
+    outputFile.write(reinterpret_cast<const char *>(&fch1), sizeof(fch1));
+    writeSIGPROCString(outputFile, "foff");
+    outputFile.write(reinterpret_cast<const char *>(&foff), sizeof(foff));
+    writeSIGPROCString(outputFile, "nsamples");
+    outputFile.write(reinterpret_cast<const char *>(&nsamples), sizeof(nsamples));
+    writeSIGPROCString(outputFile, "HEADER_END");
+    outputFile.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// Bit by bit transposition of packed samples, as previously implemented by readSIGPROC
+void referenceTransposePacked(const AstroData::Observation &observation, const unsigned int padding, const std::uint8_t inputBits, const std::uint8_t *input, std::vector<std::uint8_t> &data)
+{
+    for ( std::uint64_t byte = 0; byte < static_cast<std::uint64_t>(observation.getNrSamplesPerBatch() * (observation.getNrChannels() / (8.0 / inputBits))); byte++ )
+    {
+        unsigned int channel = (observation.getNrChannels() - 1) - ((byte * (8 / inputBits)) % observation.getNrChannels());
+        unsigned int sample = (byte * (8 / inputBits)) / observation.getNrChannels();
+        unsigned int sampleByte = sample / (8 / inputBits);
+        std::uint8_t sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
+        std::uint8_t buffer = input[byte];
+
+        for ( unsigned int item = 0; item < 8 / inputBits; item++ )
+        {
+            std::uint8_t channelFirstBit = item * inputBits;
+            std::uint8_t sampleBuffer = 0;
+
+            if ( item > channel )
+            {
+                unsigned int channelOffset = 0;
+                channel = (observation.getNrChannels() - 1);
+                sample += 1;
+                sampleByte = sample / (8 / inputBits);
+                sampleFirstBit = (sample % (8 / inputBits)) * inputBits;
+
+                while ( item < (8 / inputBits) )
+                {
+                    channelFirstBit = item * inputBits;
+                    sampleBuffer = data.at((static_cast<std::uint64_t>(channel - channelOffset) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding)) + sampleByte);
+                    for ( std::uint8_t bit = 0; bit < inputBits; bit++ )
+                    {
+                        isa::utils::setBit(sampleBuffer, isa::utils::getBit(buffer, channelFirstBit + bit), sampleFirstBit + bit);
+                    }
+                    data.at((static_cast<std::uint64_t>(channel - channelOffset) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding)) + sampleByte) = sampleBuffer;
+                    item++;
+                    channelOffset++;
+                }
+                break;
+            }
+            sampleBuffer = data.at((static_cast<std::uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding)) + sampleByte);
+            for ( std::uint8_t bit = 0; bit < inputBits; bit++ )
+            {
+                isa::utils::setBit(sampleBuffer, isa::utils::getBit(buffer, channelFirstBit + bit), sampleFirstBit + bit);
+            }
+            data.at((static_cast<std::uint64_t>(channel - item) * isa::utils::pad(observation.getNrSamplesPerBatch() / (8 / inputBits), padding)) + sampleByte) = sampleBuffer;
+        }
+    }
+}
+
 int main(int argc, char * argv[])
 {
     testing::InitGoogleTest(&argc, argv);
@@ -84,3 +188,955 @@ TEST(IntegrationSteps, MatchingSteps)
     EXPECT_EQ(*steps.find(100), 100);
     EXPECT_EQ(steps.find(12500), steps.end());
 }
+
+TEST(SIGPROCMapping, FileError)
+{
+    AstroData::Observation observation;
+    ASSERT_THROW(AstroData::SIGPROCMapping(observation, 8, 0, wrongFileName), AstroData::FileError);
+}
+
+TEST(SIGPROCMapping, BatchViews)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData;
+    std::vector<std::uint8_t> batchData;
+    const std::string filename = testing::TempDir() + "mapping.fil";
+    const unsigned int padding = 64;
+    observation.setFrequencyRange(1, 16, 0.0f, 0.0f);
+    observation.setNrSamplesPerBatch(40);
+    fileData.resize(3 * observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = item % 251;
+    }
+    writeTestFile(filename, 137, fileData);
+    AstroData::SIGPROCMapping mapping(observation, 8, 137, filename);
+    EXPECT_EQ(mapping.getNrBatches(), 3);
+    EXPECT_EQ(mapping.getBatchSize(), observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    mapping.prefetch(1, 2);
+    for ( unsigned int batch = 0; batch < mapping.getNrBatches(); batch++ )
+    {
+        EXPECT_EQ(std::memcmp(mapping.getBatch<std::uint8_t>(batch), fileData.data() + (batch * mapping.getBatchSize()), mapping.getBatchSize()), 0);
+    }
+    batchData.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding));
+    AstroData::readSIGPROC(observation, padding, 8, mapping, &batchData, 2);
+    mapping.release(0, 3);
+    for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+    {
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            std::uint64_t item = (2 * mapping.getBatchSize()) + (sample * observation.getNrChannels()) + (observation.getNrChannels() - 1 - channel);
+            EXPECT_EQ(batchData.at((channel * observation.getNrSamplesPerBatch(false, padding)) + sample), fileData.at(item));
+        }
+    }
+    batchData.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    EXPECT_THROW(AstroData::readSIGPROC(observation, padding, 8, mapping, &batchData, 2), std::out_of_range);
+    EXPECT_THROW(mapping.getBatch<std::uint8_t>(3), AstroData::FileError);
+}
+
+TEST(SIGPROCMapping, UnalignedBatches)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint16_t> items;
+    std::vector<std::uint8_t> fileData;
+    std::vector<std::uint16_t> batchData;
+    const std::string filename = testing::TempDir() + "unaligned.fil";
+    const unsigned int padding = 64;
+    observation.setFrequencyRange(1, 8, 0.0f, 0.0f);
+    observation.setNrSamplesPerBatch(24);
+    items.resize(2 * observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    for ( std::uint64_t item = 0; item < items.size(); item++ )
+    {
+        items.at(item) = (item * 257) % 65521;
+    }
+    fileData.resize(items.size() * sizeof(std::uint16_t));
+    std::memcpy(fileData.data(), items.data(), fileData.size());
+    // An odd header leaves every batch misaligned for 16 bit items
+    writeTestFile(filename, 137, fileData);
+    AstroData::SIGPROCMapping mapping(observation, 16, 137, filename);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mapping.getBatchAddress(1)) % 2, 1);
+    EXPECT_THROW(mapping.getBatch<std::uint16_t>(1), AstroData::FileError);
+    EXPECT_NO_THROW(mapping.getBatch<std::uint8_t>(1));
+    batchData.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(std::uint16_t)));
+    AstroData::readSIGPROC(observation, padding, 16, mapping, &batchData, 1);
+    for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+    {
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            std::uint64_t item = ((observation.getNrSamplesPerBatch() + sample) * observation.getNrChannels()) + (observation.getNrChannels() - 1 - channel);
+            EXPECT_EQ(batchData.at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(std::uint16_t))) + sample), items.at(item));
+        }
+    }
+}
+
+TEST(SIGPROC, ReadBatches)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData;
+    std::vector<std::vector<std::uint16_t> *> batches;
+    std::vector<std::uint16_t> batch;
+    std::vector<std::uint16_t> unpadded;
+    const std::string filename = testing::TempDir() + "batches.fil";
+    const unsigned int padding = 64;
+    observation.setFrequencyRange(1, 75, 0.0f, 0.0f);
+    observation.setNrSamplesPerBatch(130);
+    observation.setNrBatches(2);
+    fileData.resize(observation.getNrBatches() * observation.getNrChannels() * observation.getNrSamplesPerBatch() * sizeof(std::uint16_t));
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 7) % 253;
+    }
+    writeTestFile(filename, 42, fileData);
+    const std::uint16_t *items = reinterpret_cast<const std::uint16_t *>(fileData.data());
+    batches.resize(observation.getNrBatches());
+    AstroData::readSIGPROC(observation, padding, 16, 42, filename, batches);
+    batch.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(std::uint16_t)));
+    AstroData::readSIGPROCBatch(observation, padding, 16, 42, filename, &batch, 1);
+    // The single batch reader keeps the rows unpadded
+    unpadded.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    AstroData::readSIGPROC(observation, padding, 16, 42, filename, &unpadded, 1);
+    for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+    {
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            std::uint64_t index = (channel * observation.getNrSamplesPerBatch(false, padding / sizeof(std::uint16_t))) + sample;
+            std::uint64_t item = (sample * observation.getNrChannels()) + (observation.getNrChannels() - 1 - channel);
+            EXPECT_EQ(batches.at(0)->at(index), items[item]);
+            EXPECT_EQ(batches.at(1)->at(index), items[(observation.getNrChannels() * observation.getNrSamplesPerBatch()) + item]);
+            EXPECT_EQ(batch.at(index), batches.at(1)->at(index));
+            EXPECT_EQ(unpadded.at((channel * observation.getNrSamplesPerBatch()) + sample), batches.at(1)->at(index));
+        }
+    }
+    // Undersized data structures are rejected before being written
+    batch.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    EXPECT_THROW(AstroData::readSIGPROCBatch(observation, padding, 16, 42, filename, &batch, 1), std::out_of_range);
+    unpadded.resize(unpadded.size() - 1);
+    EXPECT_THROW(AstroData::readSIGPROC(observation, padding, 16, 42, filename, &unpadded, 1), std::out_of_range);
+    // firstBatch counts from zero
+    AstroData::Observation lastBatch = observation;
+    std::vector<std::vector<std::uint16_t> *> skipped(1);
+    lastBatch.setNrBatches(1);
+    AstroData::readSIGPROC(lastBatch, padding, 16, 42, filename, skipped, 1);
+    EXPECT_EQ(*skipped.at(0), *batches.at(1));
+    delete skipped.at(0);
+    for ( auto batchData : batches )
+    {
+        delete batchData;
+    }
+}
+
+TEST(SIGPROC, PackedEquivalence)
+{
+    const unsigned int padding = 32;
+    const std::string filename = testing::TempDir() + "packed.fil";
+
+    for ( std::uint8_t inputBits : {1, 2, 4} )
+    {
+        for ( unsigned int nrChannels : {48, 1536, 13} )
+        {
+            AstroData::Observation observation;
+            std::vector<std::uint8_t> fileData;
+            std::vector<std::vector<std::uint8_t> *> batches;
+            std::vector<std::uint8_t> reference;
+            std::vector<std::uint8_t> unpadded;
+            observation.setFrequencyRange(1, nrChannels, 0.0f, 0.0f);
+            observation.setNrSamplesPerBatch(96);
+            observation.setNrBatches(2);
+            fileData.resize(observation.getNrBatches() * AstroData::getSIGPROCBatchSize<std::uint8_t>(observation, inputBits));
+            for ( std::uint64_t byte = 0; byte < fileData.size(); byte++ )
+            {
+                fileData.at(byte) = ((byte * 2654435761u) >> 7) % 256;
+            }
+            writeTestFile(filename, 10, fileData);
+            batches.resize(observation.getNrBatches());
+            AstroData::readSIGPROC(observation, padding, inputBits, 10, filename, batches);
+            for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+            {
+                reference.assign(batches.at(batch)->size(), 0);
+                referenceTransposePacked(observation, padding, inputBits, fileData.data() + (batch * AstroData::getSIGPROCBatchSize<std::uint8_t>(observation, inputBits)), reference);
+                EXPECT_EQ(*(batches.at(batch)), reference) << "bits: " << static_cast<unsigned int>(inputBits) << ", channels: " << nrChannels << ", batch: " << batch;
+                // Rows of the single batch reader are not padded
+                const std::uint64_t nrPaddedBytes = reference.size() / nrChannels;
+                const std::uint64_t nrRowBytes = observation.getNrSamplesPerBatch() / (8 / inputBits);
+                unpadded.assign(nrChannels * nrRowBytes, 0);
+                AstroData::readSIGPROC(observation, padding, inputBits, 10, filename, &unpadded, batch);
+                for ( unsigned int channel = 0; channel < nrChannels; channel++ )
+                {
+                    EXPECT_TRUE(std::equal(unpadded.begin() + (channel * nrRowBytes), unpadded.begin() + ((channel + 1) * nrRowBytes), reference.begin() + (channel * nrPaddedBytes)));
+                }
+                delete batches.at(batch);
+            }
+        }
+    }
+}
+
+TEST(BatchArena, ReadSIGPROC)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData;
+    std::vector<std::vector<std::uint8_t> *> batches;
+    AstroData::BatchArena<std::uint8_t> arena;
+    const std::string filename = testing::TempDir() + "arena.fil";
+    const unsigned int padding = 64;
+    observation.setFrequencyRange(1, 37, 0.0f, 0.0f);
+    observation.setNrSamplesPerBatch(100);
+    observation.setNrBatches(3);
+    fileData.resize(observation.getNrBatches() * observation.getNrChannels() * observation.getNrSamplesPerBatch());
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 11) % 251;
+    }
+    writeTestFile(filename, 42, fileData);
+    batches.resize(observation.getNrBatches());
+    AstroData::readSIGPROC(observation, padding, 8, 42, filename, batches);
+    AstroData::readSIGPROC(observation, padding, 8, 42, filename, arena);
+    ASSERT_EQ(arena.getNrSlots(), observation.getNrBatches());
+    ASSERT_EQ(arena.getSlotSize(), batches.at(0)->size());
+    const std::uint8_t *firstSlot = arena.getSlot(0);
+    for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+    {
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(arena.getSlot(batch)) % padding, 0u);
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+            {
+                std::uint64_t index = (channel * observation.getNrSamplesPerBatch(false, padding)) + sample;
+                EXPECT_EQ(arena.getSlot(batch)[index], batches.at(batch)->at(index));
+            }
+        }
+        delete batches.at(batch);
+    }
+    // A smaller set of batches reuses the same memory
+    observation.setNrBatches(2);
+    AstroData::readSIGPROC(observation, padding, 8, 42, filename, arena);
+    EXPECT_EQ(arena.getSlot(0), firstSlot);
+    std::uint8_t *slot = arena.acquire();
+    EXPECT_NE(slot, nullptr);
+    EXPECT_NE(arena.acquire(), nullptr);
+    EXPECT_EQ(arena.acquire(), nullptr);
+    arena.release(slot);
+    EXPECT_EQ(arena.acquire(), slot);
+}
+
+TEST(SIGPROC, ParallelEquivalence)
+{
+    const unsigned int padding = 64;
+    const std::string filename = testing::TempDir() + "parallel.fil";
+    // Bits, channels, samples per batch, batches and threads; covering both batches and sample ranges per thread
+    const std::vector<std::vector<unsigned int>> configurations = {{8, 37, 1000, 2, 4}, {8, 37, 1000, 9, 4}, {16, 20, 300, 3, 3}, {4, 48, 4096, 1, 3}, {2, 13, 2000, 2, 5}, {1, 64, 1024, 2, 2}};
+
+    for ( auto configuration : configurations )
+    {
+        AstroData::Observation observation;
+        std::vector<std::uint8_t> fileData;
+        const std::uint8_t inputBits = configuration.at(0);
+        observation.setFrequencyRange(1, configuration.at(1), 0.0f, 0.0f);
+        observation.setNrSamplesPerBatch(configuration.at(2));
+        observation.setNrBatches(configuration.at(3));
+        if ( inputBits == 16 )
+        {
+            std::vector<std::vector<std::uint16_t> *> serial(observation.getNrBatches());
+            std::vector<std::vector<std::uint16_t>> parallel(observation.getNrBatches(), std::vector<std::uint16_t>(AstroData::getPaddedBatchSize<std::uint16_t>(observation, padding, inputBits)));
+            std::vector<std::uint16_t *> parallelBatches;
+
+            fileData.resize((observation.getNrBatches() + 1) * AstroData::getSIGPROCBatchSize<std::uint16_t>(observation, inputBits));
+            for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+            {
+                fileData.at(item) = (item * 13) % 255;
+            }
+            writeTestFile(filename, 42, fileData);
+            for ( auto &batch : parallel )
+            {
+                parallelBatches.push_back(batch.data());
+            }
+            AstroData::readSIGPROC(observation, padding, inputBits, 42, filename, serial, 1);
+            AstroData::readSIGPROCParallel(observation, padding, inputBits, 42, filename, parallelBatches, configuration.at(4), 1);
+            for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+            {
+                EXPECT_EQ(*serial.at(batch), parallel.at(batch));
+                delete serial.at(batch);
+            }
+        }
+        else
+        {
+            std::vector<std::vector<std::uint8_t> *> serial(observation.getNrBatches());
+            std::vector<std::vector<std::uint8_t>> parallel(observation.getNrBatches(), std::vector<std::uint8_t>(AstroData::getPaddedBatchSize<std::uint8_t>(observation, padding, inputBits)));
+            std::vector<std::uint8_t *> parallelBatches;
+
+            fileData.resize(observation.getNrBatches() * AstroData::getSIGPROCBatchSize<std::uint8_t>(observation, inputBits));
+            for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+            {
+                fileData.at(item) = (item * 13) % 255;
+            }
+            writeTestFile(filename, 42, fileData);
+            for ( auto &batch : parallel )
+            {
+                parallelBatches.push_back(batch.data());
+            }
+            AstroData::readSIGPROC(observation, padding, inputBits, 42, filename, serial);
+            AstroData::readSIGPROCParallel(observation, padding, inputBits, 42, filename, parallelBatches, configuration.at(4));
+            for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+            {
+                EXPECT_EQ(*serial.at(batch), parallel.at(batch));
+                delete serial.at(batch);
+            }
+        }
+    }
+    EXPECT_THROW(AstroData::readSIGPROCParallel(AstroData::Observation(), padding, 8, 0, wrongFileName, std::vector<std::uint8_t *>()), AstroData::FileError);
+    EXPECT_NO_THROW(AstroData::readSIGPROCParallel(AstroData::Observation(), padding, 8, 0, filename, std::vector<std::uint8_t *>()));
+}
+
+TEST(LOFAR, ReadRawBatches)
+{
+    AstroData::Observation observation;
+    std::vector<std::vector<float>> batches;
+    std::vector<float *> batchPointers;
+    const std::string filename = testing::TempDir() + "lofar.raw";
+    const unsigned int padding = 64;
+    observation.setFrequencyRange(1, 40, 0.0f, 0.0f);
+    observation.setNrSamplesPerBatch(70);
+    observation.setNrBatches(2);
+    {
+        std::ofstream rawFile(filename, std::ios::binary);
+
+        for ( std::uint64_t item = 0; item < 3 * observation.getNrSamplesPerBatch() * observation.getNrChannels(); item++ )
+        {
+            float value = item * 0.5f;
+            char bytes[4];
+
+            std::memcpy(bytes, &value, 4);
+            std::swap(bytes[0], bytes[3]);
+            std::swap(bytes[1], bytes[2]);
+            rawFile.write(bytes, 4);
+        }
+    }
+    batches.resize(observation.getNrBatches(), std::vector<float>(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(float))));
+    for ( auto &batch : batches )
+    {
+        batchPointers.push_back(batch.data());
+    }
+    AstroData::readLOFARRaw(filename, observation, padding, batchPointers, 1);
+    for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+    {
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+            {
+                std::uint64_t item = ((((batch + 1) * observation.getNrSamplesPerBatch()) + sample) * observation.getNrChannels()) + channel;
+                EXPECT_EQ(batches.at(batch).at((channel * observation.getNrSamplesPerBatch(false, padding / sizeof(float))) + sample), item * 0.5f);
+            }
+        }
+    }
+    EXPECT_THROW(AstroData::readLOFARRaw(wrongFileName, observation, padding, batchPointers, 0), AstroData::FileError);
+}
+
+TEST(LOFAR, ReadBeams)
+{
+    AstroData::Observation observation;
+    AstroData::LOFARMetadata metadata;
+    std::vector<std::vector<std::string>> rawFilenames(2);
+    std::vector<AstroData::BatchArena<float>> data;
+    const unsigned int padding = 64;
+    metadata.minFreq = 110.0;
+    metadata.totalIntegrationTime = 3.0;
+    metadata.nrBeams = 2;
+    metadata.beams.resize(2);
+    for ( auto &beam : metadata.beams )
+    {
+        beam.nrSamples = 150;
+        beam.nrChannelsPerSubband = 8;
+        beam.channelBandwidth = 0.01220703125f;
+        beam.nrSubbands = 4;
+    }
+    AstroData::setLOFARObservation(metadata, observation, 2, 1);
+    EXPECT_THROW(AstroData::checkLOFARBeams(metadata, std::vector<std::vector<std::string>>(1)), AstroData::FileError);
+    metadata.beams.at(1).nrSubbands = 2;
+    EXPECT_THROW(AstroData::checkLOFARBeams(metadata, rawFilenames), AstroData::FileError);
+    metadata.beams.at(1).nrSubbands = 4;
+    EXPECT_NO_THROW(AstroData::checkLOFARBeams(metadata, rawFilenames));
+    ASSERT_EQ(observation.getNrChannels(), 32);
+    ASSERT_EQ(observation.getNrSamplesPerBatch(), 50);
+    ASSERT_EQ(observation.getNrBatches(), 2);
+    // The first beam is stored in one file, the second one split in two files of 16 channels
+    rawFilenames.at(0).push_back(testing::TempDir() + "beam0.raw");
+    rawFilenames.at(1).push_back(testing::TempDir() + "beam1_part0.raw");
+    rawFilenames.at(1).push_back(testing::TempDir() + "beam1_part1.raw");
+    for ( unsigned int beam = 0; beam < rawFilenames.size(); beam++ )
+    {
+        const unsigned int nrFileChannels = observation.getNrChannels() / rawFilenames.at(beam).size();
+
+        for ( unsigned int part = 0; part < rawFilenames.at(beam).size(); part++ )
+        {
+            std::ofstream rawFile(rawFilenames.at(beam).at(part), std::ios::binary);
+
+            for ( unsigned int sample = 0; sample < 150; sample++ )
+            {
+                for ( unsigned int channel = part * nrFileChannels; channel < (part + 1) * nrFileChannels; channel++ )
+                {
+                    float value = (beam * 100000.0f) + (sample * 100.0f) + channel;
+                    char bytes[4];
+
+                    std::memcpy(bytes, &value, 4);
+                    std::swap(bytes[0], bytes[3]);
+                    std::swap(bytes[1], bytes[2]);
+                    rawFile.write(bytes, 4);
+                }
+            }
+        }
+    }
+    AstroData::readLOFARBeams(observation, padding, rawFilenames, data, 1, 3);
+    ASSERT_EQ(data.size(), 2);
+    for ( unsigned int beam = 0; beam < data.size(); beam++ )
+    {
+        for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+        {
+            for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+            {
+                for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+                {
+                    float value = (beam * 100000.0f) + ((((batch + 1) * observation.getNrSamplesPerBatch()) + sample) * 100.0f) + channel;
+                    EXPECT_EQ(data.at(beam).getSlot(batch)[(channel * observation.getNrSamplesPerBatch(false, padding / sizeof(float))) + sample], value);
+                }
+            }
+        }
+    }
+    rawFilenames.at(0).push_back(wrongFileName);
+    rawFilenames.at(0).push_back(wrongFileName);
+    EXPECT_THROW(AstroData::readLOFARBeams(observation, padding, rawFilenames, data), AstroData::FileError);
+}
+
+TEST(SIGPROCStream, FileError)
+{
+    AstroData::Observation observation;
+    ASSERT_THROW(AstroData::SIGPROCStream<std::uint8_t>(observation, 0, 8, wrongFileName), AstroData::FileError);
+    // A batch too large to allocate does not leak the open file
+    const std::string filename = testing::TempDir() + "huge.fil";
+    auto countOpenFiles = []() {
+        unsigned int nrFiles = 0;
+        DIR *directory = opendir("/proc/self/fd");
+        while ( readdir(directory) != nullptr )
+        {
+            nrFiles++;
+        }
+        closedir(directory);
+        return nrFiles;
+    };
+    writeSIGPROCFile(filename, 65536, 32, 1 << 30, std::vector<std::uint8_t>());
+    AstroData::clearSIGPROCHeaderCache();
+    observation.setNrBatches(1);
+    const unsigned int nrOpenFiles = countOpenFiles();
+    EXPECT_THROW(AstroData::SIGPROCStream<float>(observation, 0, 32, filename), std::bad_alloc);
+    EXPECT_EQ(countOpenFiles(), nrOpenFiles);
+}
+
+TEST(SIGPROCStream, SequentialBatches)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData(64 * 300);
+    std::vector<std::uint8_t> batch;
+    std::vector<std::uint8_t> reference;
+    const std::string filename = testing::TempDir() + "stream.fil";
+    const unsigned int padding = 32;
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 13) % 241;
+    }
+    writeSIGPROCFile(filename, 64, 8, 300, fileData);
+    observation.setNrBatches(3);
+    AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, 8, filename);
+    EXPECT_EQ(observation.getNrChannels(), 64);
+    EXPECT_EQ(observation.getNrSamplesPerBatch(), 100);
+    EXPECT_EQ(stream.getHeaderSize(), AstroData::getSIGPROCHeaderSize(filename));
+    batch.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding));
+    reference.resize(batch.size());
+    for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+    {
+        EXPECT_EQ(stream.getBatch(), batchIndex);
+        EXPECT_TRUE(stream.next(&batch));
+        AstroData::readSIGPROCBatch(observation, padding, 8, stream.getHeaderSize(), filename, &reference, batchIndex);
+        EXPECT_EQ(batch, reference);
+    }
+    EXPECT_FALSE(stream.next(&batch));
+    stream.seek(1);
+    EXPECT_TRUE(stream.next(&batch));
+    AstroData::readSIGPROCBatch(observation, padding, 8, stream.getHeaderSize(), filename, &reference, 1);
+    EXPECT_EQ(batch, reference);
+    // Undersized data structures are rejected before reading the batch
+    batch.resize(batch.size() - 1);
+    EXPECT_THROW(stream.next(&batch), std::out_of_range);
+    EXPECT_EQ(stream.getBatch(), 2u);
+}
+
+TEST(SIGPROCStream, StreamModes)
+{
+    const std::string filename = testing::TempDir() + "modes.fil";
+    const unsigned int padding = 64;
+    std::vector<std::uint8_t> fileData(2 * 48 * 3000);
+    std::vector<AstroData::StreamMode> modes = {AstroData::StreamMode::Buffered, AstroData::StreamMode::DropCache, AstroData::StreamMode::Direct};
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 7) % 249;
+    }
+    // The header of this file has an odd size, so batches are not aligned to the data type
+    writeSIGPROCFile(filename, 48, 16, 3000, fileData, "B1937+21");
+    for ( auto mode : modes )
+    {
+        AstroData::Observation observation;
+        std::vector<std::uint16_t> batch;
+        std::vector<std::uint16_t> reference;
+        observation.setNrBatches(5);
+        AstroData::SIGPROCStream<std::uint16_t> stream(observation, padding, 16, filename, 0, mode);
+        ASSERT_EQ(stream.getHeaderSize() % 2, 1u);
+        if ( mode != AstroData::StreamMode::Direct )
+        {
+            EXPECT_EQ(stream.getMode(), mode);
+        }
+        batch.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding / sizeof(std::uint16_t)));
+        reference.resize(batch.size());
+        for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+        {
+            EXPECT_TRUE(stream.next(&batch));
+            AstroData::readSIGPROCBatch(observation, padding, 16, stream.getHeaderSize(), filename, &reference, batchIndex);
+            EXPECT_EQ(batch, reference);
+        }
+        EXPECT_FALSE(stream.next(&batch));
+    }
+}
+
+TEST(SIGPROCStream, ReducedBatches)
+{
+    const std::string filename = testing::TempDir() + "reduced.fil";
+    const unsigned int padding = 64;
+
+    for ( std::uint8_t inputBits : {2, 8} )
+    {
+        std::vector<std::uint8_t> fileData(2 * 64 * 1000 * inputBits / 8);
+        for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+        {
+            fileData.at(item) = (item * 13) % 251;
+        }
+        writeSIGPROCFile(filename, 64, inputBits, 2000, fileData);
+        AstroData::clearSIGPROCHeaderCache();
+        for ( bool subbands : {false, true} )
+        {
+            AstroData::Observation observation;
+            std::vector<std::uint8_t> reference;
+            std::vector<std::uint32_t> batch;
+            observation.setNrBatches(2);
+            observation.setDownsampling(3);
+            AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, inputBits, filename, 8);
+            const unsigned int nrRows = subbands ? observation.getNrSubbands() : observation.getNrChannels();
+            const unsigned int nrChannelsPerRow = observation.getNrChannels() / nrRows;
+            const unsigned int nrOutputSamples = observation.getNrSamplesPerBatch() / 3;
+            const std::uint64_t nrPaddedSamples = AstroData::getReducedBatchSize<std::uint32_t>(observation, padding, subbands) / nrRows;
+            EXPECT_EQ(nrOutputSamples, 333u);
+            batch.resize(AstroData::getReducedBatchSize<std::uint32_t>(observation, padding, subbands));
+            reference.resize(AstroData::getPaddedBatchSize<std::uint8_t>(observation, padding, inputBits));
+            const std::uint64_t nrReferenceBytes = reference.size() / observation.getNrChannels();
+            for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+            {
+                EXPECT_TRUE(stream.nextReduced(&batch, subbands));
+                AstroData::readSIGPROCBatch(observation, padding, inputBits, stream.getHeaderSize(), filename, &reference, batchIndex);
+                for ( unsigned int row = 0; row < nrRows; row++ )
+                {
+                    for ( unsigned int sample = 0; sample < nrOutputSamples; sample++ )
+                    {
+                        std::uint32_t sum = 0;
+                        for ( unsigned int channel = row * nrChannelsPerRow; channel < (row + 1) * nrChannelsPerRow; channel++ )
+                        {
+                            for ( unsigned int step = 0; step < 3; step++ )
+                            {
+                                const unsigned int inputSample = (sample * 3) + step;
+                                if ( inputBits == 8 )
+                                {
+                                    sum += reference.at((channel * nrReferenceBytes) + inputSample);
+                                }
+                                else
+                                {
+                                    sum += (reference.at((channel * nrReferenceBytes) + (inputSample / 4)) >> ((inputSample % 4) * 2)) & 0x03;
+                                }
+                            }
+                        }
+                        ASSERT_EQ(batch.at((row * nrPaddedSamples) + sample), sum);
+                    }
+                }
+            }
+            EXPECT_FALSE(stream.nextReduced(&batch, subbands));
+            stream.seek(0);
+            batch.resize(batch.size() - 1);
+            EXPECT_THROW(stream.nextReduced(&batch, subbands), std::out_of_range);
+        }
+    }
+}
+
+TEST(SIGPROC, ReducedBatches)
+{
+    const std::string filename = testing::TempDir() + "reduced_readers.fil";
+    const unsigned int padding = 64;
+
+    for ( std::uint8_t inputBits : {2, 8} )
+    {
+        std::vector<std::uint8_t> fileData(3 * 64 * 1000 * inputBits / 8);
+        for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+        {
+            fileData.at(item) = (item * 13) % 251;
+        }
+        writeSIGPROCFile(filename, 64, inputBits, 3000, fileData);
+        AstroData::clearSIGPROCHeaderCache();
+        for ( bool subbands : {false, true} )
+        {
+            AstroData::Observation observation;
+            observation.setNrBatches(3);
+            observation.setDownsampling(3);
+            AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, inputBits, filename, 8);
+            const std::uint64_t batchSize = AstroData::getReducedBatchSize<std::uint32_t>(observation, padding, subbands);
+            std::vector<std::vector<std::uint32_t>> reference(observation.getNrBatches(), std::vector<std::uint32_t>(batchSize));
+            std::vector<std::vector<std::uint32_t>> serial(observation.getNrBatches() - 1, std::vector<std::uint32_t>(batchSize));
+            std::vector<std::vector<std::uint32_t>> parallel(observation.getNrBatches() - 1, std::vector<std::uint32_t>(batchSize));
+            std::vector<std::uint32_t *> serialBatches;
+            std::vector<std::uint32_t *> parallelBatches;
+            std::vector<std::uint32_t> batch(batchSize);
+            for ( auto &batchData : reference )
+            {
+                EXPECT_TRUE(stream.nextReduced(&batchData, subbands));
+            }
+            for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches() - 1; batchIndex++ )
+            {
+                serialBatches.push_back(serial.at(batchIndex).data());
+                parallelBatches.push_back(parallel.at(batchIndex).data());
+            }
+            // Skip the first batch, to check that firstBatch counts from zero
+            observation.setNrBatches(2);
+            AstroData::readReducedSIGPROC<std::uint8_t>(observation, padding, inputBits, stream.getHeaderSize(), filename, serialBatches, subbands, 1);
+            AstroData::readReducedSIGPROCParallel<std::uint8_t>(observation, padding, inputBits, stream.getHeaderSize(), filename, parallelBatches, subbands, 2, 1);
+            for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+            {
+                EXPECT_EQ(serial.at(batchIndex), reference.at(batchIndex + 1));
+                EXPECT_EQ(parallel.at(batchIndex), reference.at(batchIndex + 1));
+                AstroData::readReducedSIGPROC<std::uint8_t>(observation, padding, inputBits, stream.getHeaderSize(), filename, &batch, subbands, batchIndex);
+                EXPECT_EQ(batch, reference.at(batchIndex));
+            }
+            batch.resize(batchSize - 1);
+            EXPECT_THROW(AstroData::readReducedSIGPROC<std::uint8_t>(observation, padding, inputBits, stream.getHeaderSize(), filename, &batch, subbands), std::out_of_range);
+        }
+    }
+    EXPECT_THROW(AstroData::readReducedSIGPROC<std::uint8_t>(AstroData::Observation(), 64, 8, 0, wrongFileName, std::vector<std::uint32_t *>()), AstroData::FileError);
+    EXPECT_THROW(AstroData::readReducedSIGPROCParallel<std::uint8_t>(AstroData::Observation(), 64, 8, 0, wrongFileName, std::vector<std::uint32_t *>()), AstroData::FileError);
+}
+
+TEST(SIGPROCStream, CompactedBatches)
+{
+    const std::string filename = testing::TempDir() + "compacted.fil";
+    const unsigned int padding = 64;
+
+    for ( std::uint8_t inputBits : {4, 8} )
+    {
+        AstroData::Observation observation;
+        std::vector<unsigned int> zappedChannels;
+        std::vector<std::uint8_t> fileData(2 * 1024 * 200 * inputBits / 8);
+        std::vector<std::uint8_t> reference;
+        std::vector<std::uint8_t> batch;
+        for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+        {
+            fileData.at(item) = (item * 17) % 253;
+        }
+        writeSIGPROCFile(filename, 1024, inputBits, 400, fileData);
+        AstroData::clearSIGPROCHeaderCache();
+        observation.setNrBatches(2);
+        AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, inputBits, filename);
+        zappedChannels.resize(observation.getNrChannels());
+        AstroData::readZappedChannels(observation, path + "/zapped_channels.conf", zappedChannels);
+        const std::vector<unsigned int> channelMap = AstroData::getChannelMap(observation, zappedChannels);
+        ASSERT_EQ(channelMap.size(), observation.getNrChannels() - observation.getNrZappedChannels());
+        EXPECT_EQ(channelMap.at(0), 1u);
+        batch.resize(AstroData::getCompactedBatchSize<std::uint8_t>(observation, padding, inputBits, channelMap));
+        reference.resize(AstroData::getPaddedBatchSize<std::uint8_t>(observation, padding, inputBits));
+        const std::uint64_t nrRowBytes = reference.size() / observation.getNrChannels();
+        for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+        {
+            EXPECT_TRUE(stream.nextCompacted(&batch, channelMap));
+            AstroData::readSIGPROCBatch(observation, padding, inputBits, stream.getHeaderSize(), filename, &reference, batchIndex);
+            for ( unsigned int row = 0; row < channelMap.size(); row++ )
+            {
+                for ( std::uint64_t byte = 0; byte < observation.getNrSamplesPerBatch() * inputBits / 8; byte++ )
+                {
+                    ASSERT_EQ(batch.at((row * nrRowBytes) + byte), reference.at((channelMap.at(row) * nrRowBytes) + byte));
+                }
+            }
+        }
+        EXPECT_FALSE(stream.nextCompacted(&batch, channelMap));
+        stream.seek(0);
+        EXPECT_THROW(stream.nextCompacted(&reference, std::vector<unsigned int>(observation.getNrChannels() + 1)), std::out_of_range);
+        EXPECT_THROW(AstroData::compactSIGPROC(observation, padding, inputBits, fileData.data(), batch.data(), std::vector<unsigned int>{0, observation.getNrChannels()}), AstroData::FileError);
+    }
+}
+
+TEST(SIGPROCStream, ConvertedBatches)
+{
+    const std::string filename = testing::TempDir() + "converted.fil";
+    const unsigned int padding = 64;
+    AstroData::Observation observation;
+    std::vector<float> samples(2 * 48 * 300);
+    std::vector<std::uint8_t> fileData(samples.size() * sizeof(float));
+    std::vector<float> reference;
+    std::vector<AstroData::half> batch;
+
+    for ( std::uint64_t item = 0; item < samples.size(); item++ )
+    {
+        samples.at(item) = ((item * 37) % 1001) / 7.0f;
+    }
+    std::memcpy(fileData.data(), samples.data(), fileData.size());
+    writeSIGPROCFile(filename, 48, 32, 600, fileData);
+    AstroData::clearSIGPROCHeaderCache();
+    observation.setNrBatches(2);
+    AstroData::SIGPROCStream<float> stream(observation, padding, 32, filename);
+    batch.resize(AstroData::getPaddedBatchSize<AstroData::half>(observation, padding, 16));
+    reference.resize(AstroData::getPaddedBatchSize<float>(observation, padding, 32));
+    const unsigned int nrHalfSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(AstroData::half));
+    const unsigned int nrFloatSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(float));
+    for ( unsigned int batchIndex = 0; batchIndex < observation.getNrBatches(); batchIndex++ )
+    {
+        EXPECT_TRUE(stream.nextConverted(&batch, 2.0f, -1.0f));
+        AstroData::readSIGPROCBatch(observation, padding, 32, stream.getHeaderSize(), filename, &reference, batchIndex);
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+            {
+                const float value = (reference.at((channel * nrFloatSamples) + sample) * 2.0f) - 1.0f;
+                ASSERT_EQ(batch.at((channel * nrHalfSamples) + sample).bits, AstroData::floatToHalf(value).bits);
+                ASSERT_NEAR(AstroData::halfToFloat(batch.at((channel * nrHalfSamples) + sample)), value, std::abs(value) / 1024.0f);
+            }
+        }
+    }
+    EXPECT_FALSE(stream.nextConverted(&batch));
+    stream.seek(0);
+    batch.resize(batch.size() - 1);
+    EXPECT_THROW(stream.nextConverted(&batch), std::out_of_range);
+}
+
+TEST(Half, Conversions)
+{
+    EXPECT_EQ(AstroData::floatToHalf(1.0f).bits, 0x3c00);
+    EXPECT_EQ(AstroData::floatToHalf(-2.0f).bits, 0xc000);
+    EXPECT_EQ(AstroData::floatToHalf(65504.0f).bits, 0x7bff);
+    EXPECT_EQ(AstroData::floatToHalf(65520.0f).bits, 0x7c00);
+    EXPECT_EQ(AstroData::floatToHalf(1.0f + (1.0f / 2048.0f)).bits, 0x3c00);
+    EXPECT_EQ(AstroData::floatToHalf(1.0f + (3.0f / 2048.0f)).bits, 0x3c02);
+    EXPECT_EQ(AstroData::floatToHalf(std::ldexp(1.0f, -24)).bits, 0x0001);
+    EXPECT_EQ(AstroData::floatToHalf(std::ldexp(1.0f, -26)).bits, 0x0000);
+    EXPECT_TRUE(std::isnan(AstroData::halfToFloat(AstroData::floatToHalf(std::nanf("")))));
+    // Every half precision value, except NaN, survives the round trip
+    for ( std::uint32_t bits = 0; bits < 0x10000; bits++ )
+    {
+        AstroData::half value{static_cast<std::uint16_t>(bits)};
+        if ( ((bits & 0x7c00) == 0x7c00) && ((bits & 0x03ff) != 0) )
+        {
+            continue;
+        }
+        ASSERT_EQ(AstroData::floatToHalf(AstroData::halfToFloat(value)).bits, bits);
+    }
+}
+
+TEST(BatchPrefetcher, PrefetchStream)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData(32 * 1000);
+    std::vector<std::uint8_t> reference;
+    const std::string filename = testing::TempDir() + "prefetch.fil";
+    const unsigned int padding = 32;
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 11) % 239;
+    }
+    writeSIGPROCFile(filename, 32, 8, 1000, fileData);
+    observation.setNrBatches(10);
+    AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, 8, filename);
+    reference.resize(observation.getNrChannels() * observation.getNrSamplesPerBatch(false, padding));
+    AstroData::BatchPrefetcher<std::uint8_t> prefetcher([&stream](std::vector<std::uint8_t> *data) { return stream.next(data); }, reference.size(), 3);
+    for ( unsigned int batch = 0; batch < observation.getNrBatches(); batch++ )
+    {
+        std::vector<std::uint8_t> *data = prefetcher.acquire();
+        ASSERT_NE(data, nullptr);
+        AstroData::readSIGPROCBatch(observation, padding, 8, stream.getHeaderSize(), filename, &reference, batch);
+        EXPECT_EQ(*data, reference);
+        prefetcher.release(data);
+    }
+    EXPECT_EQ(prefetcher.acquire(), nullptr);
+    EXPECT_GE(prefetcher.getStallTime(), 0.0);
+}
+
+TEST(BatchPrefetcher, SourceError)
+{
+    AstroData::BatchPrefetcher<float> prefetcher([](std::vector<float> *) -> bool { throw AstroData::FileError("ERROR: test"); }, 16);
+    EXPECT_THROW(prefetcher.acquire(), AstroData::FileError);
+}
+
+TEST(DispersedBatchRing, OverlappingBatches)
+{
+    AstroData::Observation observation;
+    std::vector<std::uint8_t> fileData(20 * 600);
+    std::vector<std::vector<std::uint8_t> *> reference;
+    unsigned int nrBatches = 0;
+    unsigned int nrReads = 0;
+    const std::string filename = testing::TempDir() + "ring.fil";
+    const unsigned int padding = 32;
+    for ( std::uint64_t item = 0; item < fileData.size(); item++ )
+    {
+        fileData.at(item) = (item * 17) % 239;
+    }
+    writeSIGPROCFile(filename, 20, 8, 600, fileData);
+    observation.setNrBatches(6);
+    AstroData::SIGPROCStream<std::uint8_t> stream(observation, padding, 8, filename);
+    observation.setNrDelayBatches(3);
+    reference.resize(observation.getNrBatches());
+    AstroData::readSIGPROC(observation, padding, 8, stream.getHeaderSize(), filename, reference);
+    AstroData::DispersedBatchRing<std::uint8_t> ring([&stream, &nrReads](std::vector<std::uint8_t> *data) { nrReads++; return stream.next(data); }, observation, padding);
+    while ( ring.next() )
+    {
+        EXPECT_EQ(ring.getBatch(), nrBatches);
+        ASSERT_EQ(ring.getBatches().size(), observation.getNrDelayBatches());
+        for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+        {
+            for ( unsigned int sample = 0; sample < observation.getNrDelayBatches() * observation.getNrSamplesPerBatch(); sample++ )
+            {
+                unsigned int batch = ring.getBatch() + (sample / observation.getNrSamplesPerBatch());
+                EXPECT_EQ(ring.at(channel, sample), reference.at(batch)->at((channel * observation.getNrSamplesPerBatch(false, padding)) + (sample % observation.getNrSamplesPerBatch())));
+            }
+        }
+        nrBatches++;
+    }
+    // Every batch is read once, plus the final read that reaches the end of the stream
+    EXPECT_EQ(nrBatches, observation.getNrBatches() - observation.getNrDelayBatches() + 1);
+    EXPECT_EQ(nrReads, observation.getNrBatches() + 1);
+    EXPECT_FALSE(ring.next());
+    for ( auto batch : reference )
+    {
+        delete batch;
+    }
+}
+
+TEST(SIGPROCHeader, FileError)
+{
+    ASSERT_THROW(AstroData::readSIGPROCHeader(wrongFileName), AstroData::FileError);
+}
+
+TEST(SIGPROCHeader, FullHeader)
+{
+    const std::string filename = testing::TempDir() + "header.fil";
+    std::vector<std::uint8_t> fileData(16 * 4 * 250);
+    AstroData::Observation observation;
+    {
+        std::ofstream outputFile(filename, std::ios::binary);
+        std::int32_t intValue = 0;
+        double doubleValue = 0.0;
+
+        writeSIGPROCString(outputFile, "HEADER_START");
+        writeSIGPROCString(outputFile, "source_name");
+        writeSIGPROCString(outputFile, "B0531+21");
+        writeSIGPROCString(outputFile, "nchans");
+        intValue = 16;
+        outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+        writeSIGPROCString(outputFile, "nbits");
+        intValue = 8;
+        outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+        writeSIGPROCString(outputFile, "nifs");
+        intValue = 4;
+        outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+        writeSIGPROCString(outputFile, "nbeams");
+        intValue = 12;
+        outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+        writeSIGPROCString(outputFile, "ibeam");
+        intValue = 7;
+        outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+        writeSIGPROCString(outputFile, "tstart");
+        doubleValue = 58000.5;
+        outputFile.write(reinterpret_cast<const char *>(&doubleValue), sizeof(doubleValue));
+        writeSIGPROCString(outputFile, "tsamp");
+        doubleValue = 0.001;
+        outputFile.write(reinterpret_cast<const char *>(&doubleValue), sizeof(doubleValue));
+        writeSIGPROCString(outputFile, "fch1");
+        doubleValue = 1400.0;
+        outputFile.write(reinterpret_cast<const char *>(&doubleValue), sizeof(doubleValue));
+        writeSIGPROCString(outputFile, "foff");
+        doubleValue = -1.0;
+        outputFile.write(reinterpret_cast<const char *>(&doubleValue), sizeof(doubleValue));
+        writeSIGPROCString(outputFile, "HEADER_END");
+        outputFile.write(reinterpret_cast<const char *>(fileData.data()), fileData.size());
+    }
+    AstroData::clearSIGPROCHeaderCache();
+    AstroData::SIGPROCHeader header = AstroData::getSIGPROCHeader(filename);
+    EXPECT_EQ(header.sourceName, "B0531+21");
+    EXPECT_EQ(header.nchans, 16);
+    EXPECT_EQ(header.nbits, 8);
+    EXPECT_EQ(header.nifs, 4);
+    EXPECT_EQ(header.nbeams, 12);
+    EXPECT_EQ(header.ibeam, 7);
+    EXPECT_DOUBLE_EQ(header.tstart, 58000.5);
+    EXPECT_DOUBLE_EQ(header.tsamp, 0.001);
+    // Not in the header, computed from the size of the file
+    EXPECT_EQ(header.nsamples, 250);
+    std::ifstream inputFile(filename, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(header.headerSize, static_cast<std::uint64_t>(inputFile.tellg()) - fileData.size());
+    observation.setNrBatches(5);
+    AstroData::readSIGPROCHeader(header.headerSize, observation, filename);
+    EXPECT_EQ(observation.getNrSamplesPerBatch(), 50);
+    EXPECT_EQ(observation.getNrChannels(), 16);
+    EXPECT_FLOAT_EQ(observation.getMinFreq(), 1385.0f);
+    EXPECT_FLOAT_EQ(observation.getChannelBandwidth(), 1.0f);
+    EXPECT_FLOAT_EQ(observation.getSamplingTime(), 0.001f);
+}
+
+TEST(SIGPROCHeader, OptionalKeywords)
+{
+    const std::string filename = testing::TempDir() + "optional_header.fil";
+    std::vector<std::uint8_t> fileData(8 * 100);
+    std::uint64_t headerSize = 0;
+
+    for ( bool unknownKeyword : {false, true} )
+    {
+        {
+            std::ofstream outputFile(filename, std::ios::binary);
+            std::int32_t intValue = 0;
+            std::int64_t longValue = 0;
+            char charValue = 1;
+
+            writeSIGPROCString(outputFile, "HEADER_START");
+            writeSIGPROCString(outputFile, "nchans");
+            intValue = 8;
+            outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+            writeSIGPROCString(outputFile, "signed");
+            outputFile.write(&charValue, sizeof(charValue));
+            writeSIGPROCString(outputFile, "nbins");
+            intValue = 128;
+            outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+            writeSIGPROCString(outputFile, "npuls");
+            longValue = 5000000000;
+            outputFile.write(reinterpret_cast<const char *>(&longValue), sizeof(longValue));
+            if ( unknownKeyword )
+            {
+                // Not sizeable, the rest of the header is skipped
+                writeSIGPROCString(outputFile, "custom_value");
+                outputFile.write("abc", 3);
+            }
+            writeSIGPROCString(outputFile, "nbits");
+            intValue = 8;
+            outputFile.write(reinterpret_cast<const char *>(&intValue), sizeof(intValue));
+            writeSIGPROCString(outputFile, "HEADER_END");
+            outputFile.write(reinterpret_cast<const char *>(fileData.data()), fileData.size());
+            headerSize = static_cast<std::uint64_t>(outputFile.tellp()) - fileData.size();
+        }
+        // The same file is rewritten with a different header, and must not be served from the cache
+        AstroData::SIGPROCHeader header = AstroData::readSIGPROCHeader(filename);
+        EXPECT_EQ(header.headerSize, headerSize);
+        EXPECT_EQ(header.nchans, 8);
+        EXPECT_TRUE(header.signedData);
+        EXPECT_EQ(header.nbins, 128);
+        EXPECT_EQ(header.npuls, 5000000000);
+        if ( !unknownKeyword )
+        {
+            EXPECT_EQ(header.nbits, 8);
+            EXPECT_EQ(header.nsamples, 100);
+        }
+        EXPECT_EQ(AstroData::getSIGPROCHeaderSize(filename), headerSize);
+    }
+}
@@ -0,0 +1,169 @@
+// Copyright 2019 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <RingBuffer.hpp>
+#include <ArgumentList.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <gtest/gtest.h>
+
+std::string path;
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    isa::utils::ArgumentList arguments(argc, argv);
+    try
+    {
+        path = arguments.getSwitchArgument<std::string>("-path");
+    }
+    catch ( std::exception &err )
+    {
+        std::cerr << std::endl;
+        std::cerr << "Required command line parameters:" << std::endl;
+        std::cerr << "\t-path <string> // The path of the test input files" << std::endl;
+        std::cerr << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+TEST(RingBuffer, Header)
+{
+    AstroData::RingBuffer ringBuffer(2, 1024);
+    AstroData::Observation observation;
+    EXPECT_THROW(AstroData::RingBuffer(0, 1024), AstroData::RingBufferError);
+    ringBuffer.setHeader("SAMPLES_PER_BATCH 2048\nNCHAN 384\nMIN_FREQUENCY 1250.09765625\nCHANNEL_BANDWIDTH 0.1953125\nTSAMP 0.00008192\n");
+    EXPECT_THROW(ringBuffer.setHeader(""), AstroData::RingBufferError);
+    AstroData::readRingBufferHeader(observation, ringBuffer);
+    EXPECT_EQ(observation.getNrSamplesPerBatch(), 2048);
+    EXPECT_EQ(observation.getNrChannels(), 384);
+    EXPECT_FLOAT_EQ(observation.getMinFreq(), 1250.09765625f);
+    EXPECT_FLOAT_EQ(observation.getChannelBandwidth(), 0.1953125f);
+    EXPECT_FLOAT_EQ(observation.getSamplingTime(), 0.00008192f);
+}
+
+TEST(RingBuffer, MultipleConsumers)
+{
+    const unsigned int nrBlocks = 200;
+    const unsigned int nrConsumers = 3;
+    AstroData::RingBuffer ringBuffer(4, 1000 * sizeof(unsigned int), nrConsumers);
+    std::vector<std::thread> consumers;
+    std::vector<unsigned int> nrValidBlocks(nrConsumers, 0);
+    std::thread producer([&ringBuffer]() {
+        for ( unsigned int block = 0; block < nrBlocks; block++ )
+        {
+            unsigned int *data = reinterpret_cast<unsigned int *>(ringBuffer.getNextWrite());
+
+            for ( unsigned int item = 0; item < 1000; item++ )
+            {
+                data[item] = (block * 1000) + item;
+            }
+            ringBuffer.markFilled(1000 * sizeof(unsigned int));
+        }
+        ringBuffer.markEndOfData();
+    });
+    for ( unsigned int consumer = 0; consumer < nrConsumers; consumer++ )
+    {
+        consumers.emplace_back([&ringBuffer, &nrValidBlocks, consumer]() {
+            std::vector<unsigned int> data(1000);
+
+            while ( AstroData::readRingBuffer(ringBuffer, consumer, &data) )
+            {
+                bool valid = true;
+
+                for ( unsigned int item = 0; item < data.size(); item++ )
+                {
+                    valid = valid && (data.at(item) == (nrValidBlocks.at(consumer) * 1000) + item);
+                }
+                if ( valid )
+                {
+                    nrValidBlocks.at(consumer)++;
+                }
+            }
+        });
+    }
+    producer.join();
+    for ( auto &consumer : consumers )
+    {
+        consumer.join();
+    }
+    for ( unsigned int consumer = 0; consumer < nrConsumers; consumer++ )
+    {
+        EXPECT_EQ(nrValidBlocks.at(consumer), nrBlocks);
+    }
+}
+
+TEST(RingBuffer, TransposeBlocks)
+{
+    const unsigned int padding = 64;
+    AstroData::Observation observation;
+
+    observation.setNrBeams(3);
+    observation.setNrSamplesPerBatch(5000);
+    observation.setFrequencyRange(1, 37, 1400.0f, 0.2f);
+    const unsigned int nrPaddedSamples = observation.getNrSamplesPerBatch(false, padding / sizeof(uint16_t));
+    const std::size_t blockSize = observation.getNrBeams() * observation.getNrSamplesPerBatch() * observation.getNrChannels();
+    AstroData::RingBuffer ringBuffer(2, blockSize * sizeof(uint16_t));
+
+    for ( auto layout : {AstroData::BlockLayout::TimeMajor, AstroData::BlockLayout::BeamMajor} )
+    {
+        std::vector<std::vector<uint16_t>> beams(observation.getNrBeams(), std::vector<uint16_t>(observation.getNrChannels() * nrPaddedSamples));
+        std::vector<uint16_t *> output;
+        uint16_t *block = reinterpret_cast<uint16_t *>(ringBuffer.getNextWrite());
+
+        // Every item encodes its beam, sample and channel
+        for ( unsigned int beam = 0; beam < observation.getNrBeams(); beam++ )
+        {
+            for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+            {
+                for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+                {
+                    std::size_t item = 0;
+
+                    if ( layout == AstroData::BlockLayout::TimeMajor )
+                    {
+                        item = (((sample * observation.getNrBeams()) + beam) * observation.getNrChannels()) + channel;
+                    }
+                    else
+                    {
+                        item = (((beam * observation.getNrSamplesPerBatch()) + sample) * observation.getNrChannels()) + channel;
+                    }
+                    block[item] = (beam * 20000) + (sample * 3) + channel;
+                }
+            }
+        }
+        ringBuffer.markFilled(blockSize * sizeof(uint16_t));
+        for ( auto &beam : beams )
+        {
+            output.push_back(beam.data());
+        }
+        ASSERT_TRUE(AstroData::readRingBuffer(ringBuffer, 0, observation, padding, layout, output, 2));
+        for ( unsigned int beam = 0; beam < observation.getNrBeams(); beam++ )
+        {
+            for ( unsigned int channel = 0; channel < observation.getNrChannels(); channel++ )
+            {
+                for ( unsigned int sample = 0; sample < observation.getNrSamplesPerBatch(); sample++ )
+                {
+                    ASSERT_EQ(beams.at(beam).at((channel * nrPaddedSamples) + sample), static_cast<uint16_t>((beam * 20000) + (sample * 3) + channel));
+                }
+            }
+        }
+    }
+    ringBuffer.markEndOfData();
+    std::vector<uint16_t *> output;
+    EXPECT_FALSE(AstroData::readRingBuffer(ringBuffer, 0, observation, padding, AstroData::BlockLayout::TimeMajor, output));
+}
@@ -0,0 +1,130 @@
+// Copyright 2019 Netherlands eScience Center and Netherlands Institute for Radio Astronomy (ASTRON)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <WriteData.hpp>
+#include <ArgumentList.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+std::string path;
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    isa::utils::ArgumentList arguments(argc, argv);
+    try
+    {
+        path = arguments.getSwitchArgument<std::string>("-path");
+    }
+    catch ( std::exception &err )
+    {
+        std::cerr << std::endl;
+        std::cerr << "Required command line parameters:" << std::endl;
+        std::cerr << "\t-path <string> // The path of the test input files" << std::endl;
+        std::cerr << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+// Write batches of random data, read them back, and compare the valid part of every channel
+template <typename T>
+void testRoundTrip(const unsigned int nrChannels, const unsigned int nrSamples, const std::uint8_t bits, const bool asynchronous)
+{
+    const unsigned int padding = 64;
+    const unsigned int nrBatches = 3;
+    const std::string filename = testing::TempDir() + "round_trip.fil";
+    AstroData::Observation observation;
+    AstroData::Observation readObservation;
+    AstroData::SIGPROCHeader header;
+    std::vector<std::vector<T>> batches(nrBatches);
+    std::vector<T> batch;
+
+    observation.setFrequencyRange(1, nrChannels, 1400.0f, 0.5f);
+    observation.setNrSamplesPerBatch(nrSamples);
+    observation.setNrBatches(nrBatches);
+    observation.setSamplingTime(0.001f);
+    const std::uint64_t nrPaddedItems = AstroData::getPaddedBatchSize<T>(observation, padding, bits);
+    const std::uint64_t nrRowItems = nrPaddedItems / nrChannels;
+    const std::uint64_t nrValidItems = (bits >= 8) ? nrSamples : nrSamples / (8 / bits);
+    for ( unsigned int batchIndex = 0; batchIndex < nrBatches; batchIndex++ )
+    {
+        batches.at(batchIndex).resize(nrPaddedItems);
+        for ( std::uint64_t item = 0; item < nrPaddedItems; item++ )
+        {
+            batches.at(batchIndex).at(item) = static_cast<T>(((item * 31) + (batchIndex * 7)) % ((bits >= 8) ? 251 : 256));
+        }
+    }
+    header.sourceName = "B1937+21";
+    {
+        AstroData::SIGPROCWriter<T> writer(observation, padding, bits, filename, header, asynchronous);
+
+        for ( auto &batchData : batches )
+        {
+            writer.write(batchData);
+        }
+        writer.close();
+        EXPECT_EQ(writer.getNrBatches(), nrBatches);
+        EXPECT_EQ(writer.getHeaderSize(), AstroData::getSIGPROCHeaderSize(filename));
+    }
+    AstroData::SIGPROCHeader readHeader = AstroData::readSIGPROCHeader(filename);
+    EXPECT_EQ(readHeader.sourceName, header.sourceName);
+    EXPECT_EQ(readHeader.nbits, bits);
+    EXPECT_EQ(readHeader.nsamples, nrBatches * nrSamples);
+    readObservation.setNrBatches(nrBatches);
+    AstroData::setSIGPROCObservation(readHeader, readObservation);
+    EXPECT_EQ(readObservation.getNrChannels(), nrChannels);
+    EXPECT_FLOAT_EQ(readObservation.getMinFreq(), observation.getMinFreq());
+    EXPECT_FLOAT_EQ(readObservation.getChannelBandwidth(), observation.getChannelBandwidth());
+    EXPECT_FLOAT_EQ(readObservation.getSamplingTime(), observation.getSamplingTime());
+    batch.resize(nrPaddedItems);
+    for ( unsigned int batchIndex = 0; batchIndex < nrBatches; batchIndex++ )
+    {
+        AstroData::readSIGPROCBatch(observation, padding, bits, readHeader.headerSize, filename, &batch, batchIndex);
+        for ( unsigned int channel = 0; channel < nrChannels; channel++ )
+        {
+            for ( std::uint64_t item = 0; item < nrValidItems; item++ )
+            {
+                ASSERT_EQ(batch.at((channel * nrRowItems) + item), batches.at(batchIndex).at((channel * nrRowItems) + item));
+            }
+        }
+    }
+    AstroData::clearSIGPROCHeaderCache();
+}
+
+TEST(SIGPROCWriter, FileError)
+{
+    AstroData::Observation observation;
+
+    observation.setFrequencyRange(1, 8, 1400.0f, 0.5f);
+    observation.setNrSamplesPerBatch(8);
+    EXPECT_THROW(AstroData::SIGPROCWriter<std::uint8_t>(observation, 64, 8, "/does_not_exist/file.fil"), AstroData::FileError);
+    EXPECT_THROW(AstroData::SIGPROCWriter<std::uint16_t>(observation, 64, 8, testing::TempDir() + "wrong_bits.fil"), AstroData::FileError);
+}
+
+TEST(SIGPROCWriter, RoundTrip)
+{
+    for ( auto asynchronous : {true, false} )
+    {
+        testRoundTrip<std::uint8_t>(64, 1000, 1, asynchronous);
+        testRoundTrip<std::uint8_t>(64, 1000, 2, asynchronous);
+        testRoundTrip<std::uint8_t>(80, 1000, 4, asynchronous);
+        testRoundTrip<std::uint8_t>(6, 1000, 2, asynchronous);
+        testRoundTrip<std::uint8_t>(75, 130, 8, asynchronous);
+        testRoundTrip<std::uint16_t>(75, 130, 16, asynchronous);
+        testRoundTrip<std::uint32_t>(33, 517, 32, asynchronous);
+    }
+}